@@ -40,10 +40,10 @@ public:
     // move per_tick from supplierstock to freight
     sptn::PetriNet<>::TransitionSketch supply{
         transition_name, {{place_name, per_tick}}, {{"freight", per_tick}}};
-    main_net.addTransition(supply);
+    auto supply_index = main_net.addTransition(supply);
 
     // AutoFire when this->enabled_ == true
-    main_net.findTransition(transition_name)->autoFire([&](const auto &transition) {
+    main_net.transition(supply_index).autoFire([&](const auto &transition) {
       (void)transition;  // We already know what transition is asking to fire
       return this->enabled_;
     });
@@ -55,13 +55,14 @@ public:
 
 class PortNetManager {
 private:
-  sptn::PetriNet<> net_;
+  // Ships may enter different ports in parallel, leaving serializes on the shared freight
+  sptn::PetriNet<> net_{sptn::Locking::k_places};
 
   // Important elements of the net (we want to manually fire those)
-  std::shared_ptr<sptn::PetriNet<>::TransitionT> enter_a_;
-  std::shared_ptr<sptn::PetriNet<>::TransitionT> enter_b_;
-  std::shared_ptr<sptn::PetriNet<>::TransitionT> leave_a_;
-  std::shared_ptr<sptn::PetriNet<>::TransitionT> leave_b_;
+  sptn::TransitionIndex enter_a_;
+  sptn::TransitionIndex enter_b_;
+  sptn::TransitionIndex leave_a_;
+  sptn::TransitionIndex leave_b_;
 
 public:
   PortNetManager() {
@@ -84,17 +85,11 @@ public:
     sptn::PetriNet<>::TransitionSketch leave_b = {
         "leave_b", {{"port_b", 1}, {"freight", 3}}, {{"port_b_free", 1}}};
 
-    // add sketches
-    net_.addTransition(enter_a);
-    net_.addTransition(enter_b);
-    net_.addTransition(leave_a);
-    net_.addTransition(leave_b);
-
-    // Get a reference to the real transitions (for easier access)
-    this->enter_a_ = net_.findTransition("enter_a");
-    this->enter_b_ = net_.findTransition("enter_b");
-    this->leave_a_ = net_.findTransition("leave_a");
-    this->leave_b_ = net_.findTransition("leave_b");
+    // add sketches and keep their handles (for fast access)
+    this->enter_a_ = net_.addTransition(enter_a);
+    this->enter_b_ = net_.addTransition(enter_b);
+    this->leave_a_ = net_.addTransition(leave_a);
+    this->leave_b_ = net_.addTransition(leave_b);
 
     // Print when freight arrives or was taken
     net_.findPlace("freight")->onChange([&](const auto &place, uint32_t prev_tokens) {
@@ -124,14 +119,14 @@ public:
 
   void addSupplier(Supplier &supplier) { supplier.attachToNet(this->net_); }
 
-  bool tryEnterA() { return this->enter_a_->fire(); }
-  bool tryEnterB() { return this->enter_b_->fire(); }
-  bool tryLeaveA() { return this->leave_a_->fire(); }
-  bool tryLeaveB() { return this->leave_b_->fire(); }
-  bool canEnterA() { return this->enter_a_->ready(); }
-  bool canEnterB() { return this->enter_b_->ready(); }
-  bool canLeaveA() { return this->leave_a_->ready(); }
-  bool canLeaveB() { return this->leave_b_->ready(); }
+  bool tryEnterA() { return this->net_.fire(this->enter_a_); }
+  bool tryEnterB() { return this->net_.fire(this->enter_b_); }
+  bool tryLeaveA() { return this->net_.fire(this->leave_a_); }
+  bool tryLeaveB() { return this->net_.fire(this->leave_b_); }
+  bool canEnterA() { return this->net_.ready(this->enter_a_); }
+  bool canEnterB() { return this->net_.ready(this->enter_b_); }
+  bool canLeaveA() { return this->net_.ready(this->leave_a_); }
+  bool canLeaveB() { return this->net_.ready(this->leave_b_); }
 
   void tick() { this->net_.tick(); }
 };
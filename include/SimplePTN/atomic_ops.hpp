@@ -0,0 +1,117 @@
+// Copyright Open Logistics Foundation
+// 
+// Licensed under the Open Logistics Foundation License 1.3.
+// For details on the licensing terms, see the LICENSE file.
+// SPDX-License-Identifier: OLFL-1.3
+// 
+// This file contains atomic operations on plain (non std::atomic) integers
+
+#ifndef SIMPLEPTN_INCLUDE_SIMPLEPTN_ATOMIC_OPS_HPP_
+#define SIMPLEPTN_INCLUDE_SIMPLEPTN_ATOMIC_OPS_HPP_
+
+#include <atomic>
+
+// The marking stays a plain std::vector, so it can still be copied, resized and read by the
+// compiled net while no atomic firing runs. Its elements are accessed atomically through
+// std::atomic_ref (C++20) or the equivalent compiler builtins.
+#if defined(__cpp_lib_atomic_ref)
+#define SIMPLEPTN_ATOMIC_REF 1
+#elif defined(__GNUC__) || defined(__clang__)
+#define SIMPLEPTN_ATOMIC_BUILTINS 1
+#endif
+
+namespace sptn::atomics {
+
+///
+///\brief Whether the operations of this namespace are available
+///
+#if defined(SIMPLEPTN_ATOMIC_REF) || defined(SIMPLEPTN_ATOMIC_BUILTINS)
+inline constexpr bool k_supported = true;
+#else
+inline constexpr bool k_supported = false;
+#endif
+
+#if defined(SIMPLEPTN_ATOMIC_REF)
+
+// Same semantics as the builtins below
+template <typename T> T load(const T &value) noexcept(true) {
+  // atomic_ref<const T> needs C++26, loading does not write
+  return std::atomic_ref<T>(const_cast<T &>(value)).load(std::memory_order_acquire);
+}
+
+template <typename T> void store(T &value, T desired) noexcept(true) {
+  std::atomic_ref<T>(value).store(desired, std::memory_order_release);
+}
+
+template <typename T> bool compareExchange(T &value, T &expected, T desired) noexcept(true) {
+  return std::atomic_ref<T>(value).compare_exchange_weak(
+      expected, desired, std::memory_order_acq_rel, std::memory_order_acquire);
+}
+
+template <typename T> T fetchAdd(T &value, T arg) noexcept(true) {
+  return std::atomic_ref<T>(value).fetch_add(arg, std::memory_order_acq_rel);
+}
+
+template <typename T> T fetchSub(T &value, T arg) noexcept(true) {
+  return std::atomic_ref<T>(value).fetch_sub(arg, std::memory_order_acq_rel);
+}
+
+#elif defined(SIMPLEPTN_ATOMIC_BUILTINS)
+
+///
+///\brief Read an integer shared with atomic writers
+///
+template <typename T> T load(const T &value) noexcept(true) {
+  return __atomic_load_n(&value, __ATOMIC_ACQUIRE);
+}
+
+///
+///\brief Write an integer shared with atomic readers
+///
+template <typename T> void store(T &value, T desired) noexcept(true) {
+  __atomic_store_n(&value, desired, __ATOMIC_RELEASE);
+}
+
+///
+///\brief Replace value by desired if it equals expected (may fail spuriously)
+///
+///\return true replaced
+///\return false not replaced, expected receives the current value
+///
+template <typename T> bool compareExchange(T &value, T &expected, T desired) noexcept(true) {
+  return __atomic_compare_exchange_n(&value, &expected, desired, true, __ATOMIC_ACQ_REL,
+                                     __ATOMIC_ACQUIRE);
+}
+
+///
+///\brief Add arg to value
+///
+///\return T the previous value
+///
+template <typename T> T fetchAdd(T &value, T arg) noexcept(true) {
+  return __atomic_fetch_add(&value, arg, __ATOMIC_ACQ_REL);
+}
+
+///
+///\brief Subtract arg from value
+///
+///\return T the previous value
+///
+template <typename T> T fetchSub(T &value, T arg) noexcept(true) {
+  return __atomic_fetch_sub(&value, arg, __ATOMIC_ACQ_REL);
+}
+
+#else
+
+// Never called, only declared for the discarded branches testing k_supported
+template <typename T> T load(const T &value) noexcept(true);
+template <typename T> void store(T &value, T desired) noexcept(true);
+template <typename T> bool compareExchange(T &value, T &expected, T desired) noexcept(true);
+template <typename T> T fetchAdd(T &value, T arg) noexcept(true);
+template <typename T> T fetchSub(T &value, T arg) noexcept(true);
+
+#endif
+
+}  // namespace sptn::atomics
+
+#endif  // SIMPLEPTN_INCLUDE_SIMPLEPTN_ATOMIC_OPS_HPP_
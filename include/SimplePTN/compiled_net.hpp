@@ -0,0 +1,479 @@
+// Copyright Open Logistics Foundation
+// 
+// Licensed under the Open Logistics Foundation License 1.3.
+// For details on the licensing terms, see the LICENSE file.
+// SPDX-License-Identifier: OLFL-1.3
+// 
+// This file contains the CompiledNet class
+
+#ifndef SIMPLEPTN_INCLUDE_SIMPLEPTN_COMPILED_NET_HPP_
+#define SIMPLEPTN_INCLUDE_SIMPLEPTN_COMPILED_NET_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "ready_kernels.hpp"
+
+namespace sptn {
+
+///
+///\brief Immutable flat (CSR) incidence representation of a PetriNet
+///
+/// Row t of the pre (post) incidence holds the ingoing (outgoing) arcs of the Transition with
+/// index t: the arcs offsets[t] until offsets[t + 1] of the packed places and weights arrays.
+/// Additionally, every Place stores the Transitions it is ingoing to (consumers).
+///
+/// Two Transitions conflict if an ingoing Place of one of them is a Place of the other. The
+/// Transitions are colored so that no two Transitions of one color conflict, the Transitions of
+/// one color can fire concurrently with the same result in any order.
+///
+/// Objects of this class are created by sptn::PetriNet::compile()
+///
+///\tparam TokenCounterT the counting type (must overload operator+, operator- and operator<)
+///
+template <typename TokenCounter = uint32_t> class CompiledNet {
+public:
+  using TokenCounterT = TokenCounter;
+  using PosT = std::uint32_t;
+
+  ///
+  ///\brief One incidence matrix in CSR format
+  ///
+  struct Incidence {
+    ///\brief row offsets (one row per Transition, plus the end of the last row)
+    std::vector<PosT> offsets{0};
+
+    ///\brief the place index of each arc
+    std::vector<PosT> places;
+
+    ///\brief the weight of each arc
+    std::vector<TokenCounterT> weights;
+
+    ///
+    ///\brief Append an arc to the current row
+    ///
+    ///\throws std::length_error if the arc or place does not fit into PosT
+    ///
+    void append(std::size_t place, TokenCounterT weight) noexcept(false) {
+      if (place > std::numeric_limits<PosT>::max() ||
+          this->places.size() >= std::numeric_limits<PosT>::max()) {
+        throw std::length_error("Net too large to compile");
+      }
+      this->places.push_back(static_cast<PosT>(place));
+      this->weights.push_back(weight);
+    }
+
+    ///
+    ///\brief Finish the current row
+    ///
+    void endRow() noexcept(false) {
+      this->offsets.push_back(static_cast<PosT>(this->places.size()));
+    }
+
+    ///
+    ///\brief Get the number of rows
+    ///
+    [[nodiscard]] std::size_t rows() const noexcept(true) { return this->offsets.size() - 1; }
+  };
+
+private:
+  Incidence pre_;
+  Incidence post_;
+  std::vector<PosT> consumer_offsets_;
+  std::vector<PosT> consumers_;
+  std::vector<TokenCounterT> consumer_weights_;
+  std::vector<PosT> topological_order_;
+  std::vector<PosT> color_offsets_;
+  std::vector<PosT> colored_;
+
+  ///
+  ///\brief Sort the transitions topologically (Kahn's algorithm)
+  ///
+  /// Transition u follows t if an outgoing place of t is ingoing to u. Transitions without
+  /// predecessors keep their relative order.
+  ///
+  ///\return std::vector<PosT> all transitions in topological order, empty if there is a cycle
+  /// (and at least one transition)
+  ///
+  std::vector<PosT> sortTopologically() const noexcept(false) {
+    auto for_each_successor = [this](std::size_t t, auto &&fn) {
+      for (auto k = this->post_.offsets[t]; k < this->post_.offsets[t + 1]; ++k) {
+        auto [begin, end] = this->consumers(this->post_.places[k]);
+        for (const auto *u = begin; u != end; ++u) {
+          fn(*u);
+        }
+      }
+    };
+
+    std::vector<std::size_t> predecessors(this->transitionCount(), 0);
+    for (std::size_t t = 0; t < this->transitionCount(); ++t) {
+      for_each_successor(t, [&](PosT u) { ++predecessors[u]; });
+    }
+
+    std::vector<PosT> order;
+    order.reserve(this->transitionCount());
+    for (std::size_t t = 0; t < this->transitionCount(); ++t) {
+      if (predecessors[t] == 0) {
+        order.push_back(static_cast<PosT>(t));
+      }
+    }
+    for (std::size_t i = 0; i < order.size(); ++i) {
+      for_each_successor(order[i], [&](PosT u) {
+        if (--predecessors[u] == 0) {
+          order.push_back(u);
+        }
+      });
+    }
+
+    if (order.size() != this->transitionCount()) {
+      order.clear();
+    }
+    return order;
+  }
+
+  ///
+  ///\brief Color the conflict graph greedily in index order
+  ///
+  /// The conflict graph is not built: every Place remembers the colors of its consumers and
+  /// producers, a Transition takes the lowest color none of its Places forbids.
+  ///
+  void colorConflicts() noexcept(false) {
+    auto places = this->placeCount();
+    std::vector<std::vector<PosT>> consumer_colors(places);
+    std::vector<std::vector<PosT>> producer_colors(places);
+    std::vector<std::size_t> forbidden;  // stamped with transition + 1
+    std::vector<PosT> colors(this->transitionCount());
+
+    for (std::size_t t = 0; t < this->transitionCount(); ++t) {
+      auto forbid = [&](const std::vector<PosT> &used) {
+        for (auto color : used) {
+          if (forbidden.size() <= color) {
+            forbidden.resize(color + 1, 0);
+          }
+          forbidden[color] = t + 1;
+        }
+      };
+      for (auto k = this->pre_.offsets[t]; k < this->pre_.offsets[t + 1]; ++k) {
+        forbid(consumer_colors[this->pre_.places[k]]);
+        forbid(producer_colors[this->pre_.places[k]]);
+      }
+      for (auto k = this->post_.offsets[t]; k < this->post_.offsets[t + 1]; ++k) {
+        forbid(consumer_colors[this->post_.places[k]]);
+      }
+
+      PosT color = 0;
+      while (color < forbidden.size() && forbidden[color] == t + 1) {
+        ++color;
+      }
+      colors[t] = color;
+
+      // The color is new to the consumers of all places and the producers of ingoing places
+      for (auto k = this->pre_.offsets[t]; k < this->pre_.offsets[t + 1]; ++k) {
+        consumer_colors[this->pre_.places[k]].push_back(color);
+      }
+      for (auto k = this->post_.offsets[t]; k < this->post_.offsets[t + 1]; ++k) {
+        auto &used = producer_colors[this->post_.places[k]];
+        if (std::find(cbegin(used), cend(used), color) == cend(used)) {
+          used.push_back(color);
+        }
+      }
+    }
+
+    // Counting sort of the transitions by color
+    auto color_count = this->transitionCount() == 0
+                           ? std::size_t{0}
+                           : std::size_t{*std::max_element(cbegin(colors), cend(colors))} + 1;
+    this->color_offsets_.assign(color_count + 1, 0);
+    for (auto color : colors) {
+      ++this->color_offsets_[color + 1];
+    }
+    for (std::size_t c = 0; c < color_count; ++c) {
+      this->color_offsets_[c + 1] += this->color_offsets_[c];
+    }
+    this->colored_.resize(colors.size());
+    std::vector<PosT> fill(cbegin(this->color_offsets_), cend(this->color_offsets_) - 1);
+    for (std::size_t t = 0; t < colors.size(); ++t) {
+      this->colored_[fill[colors[t]]++] = static_cast<PosT>(t);
+    }
+  }
+
+  ///
+  ///\brief Check if any bit of [from, to) is set
+  ///
+  static bool anyBit(const std::uint64_t *bits, std::size_t from, std::size_t to) noexcept(true) {
+    while (from < to) {
+      auto word = from / 64;
+      auto low = from % 64;
+      auto width = std::min<std::size_t>(to - word * 64, 64) - low;
+      auto value = bits[word] >> low;
+      if (width < 64) {
+        value &= (std::uint64_t{1} << width) - 1;
+      }
+      if (value != 0) {
+        return true;
+      }
+      from = (word + 1) * 64;
+    }
+    return false;
+  }
+
+public:
+  ///
+  ///\brief Construct a new CompiledNet
+  ///
+  ///\param place_count the number of places
+  ///\param pre the ingoing arcs of all transitions
+  ///\param post the outgoing arcs of all transitions
+  ///\throws std::invalid_argument if pre and post have a different number of rows
+  ///
+  CompiledNet(std::size_t place_count, Incidence &&pre, Incidence &&post) noexcept(false)
+      : pre_(std::move(pre)), post_(std::move(post)), consumer_offsets_(place_count + 1, 0) {
+    if (this->pre_.rows() != this->post_.rows()) {
+      throw std::invalid_argument("Incidences do not match");
+    }
+
+    // Counting sort of the pre incidence by place (transposition)
+    for (auto place : this->pre_.places) {
+      ++this->consumer_offsets_[place + 1];
+    }
+    for (std::size_t p = 0; p < place_count; ++p) {
+      this->consumer_offsets_[p + 1] += this->consumer_offsets_[p];
+    }
+
+    this->consumers_.resize(this->pre_.places.size());
+    this->consumer_weights_.resize(this->pre_.places.size());
+    std::vector<PosT> fill(cbegin(this->consumer_offsets_), cend(this->consumer_offsets_) - 1);
+    for (std::size_t t = 0; t < this->pre_.rows(); ++t) {
+      for (auto k = this->pre_.offsets[t]; k < this->pre_.offsets[t + 1]; ++k) {
+        auto pos = fill[this->pre_.places[k]]++;
+        this->consumers_[pos] = static_cast<PosT>(t);
+        this->consumer_weights_[pos] = this->pre_.weights[k];
+      }
+    }
+
+    this->topological_order_ = this->sortTopologically();
+    this->colorConflicts();
+  }
+
+  ///
+  ///\brief Get the number of transitions
+  ///
+  [[nodiscard]] std::size_t transitionCount() const noexcept(true) { return this->pre_.rows(); }
+
+  ///
+  ///\brief Get the number of places
+  ///
+  [[nodiscard]] std::size_t placeCount() const noexcept(true) {
+    return this->consumer_offsets_.size() - 1;
+  }
+
+  ///
+  ///\brief Get the ingoing arcs of all transitions
+  ///
+  [[nodiscard]] const Incidence &pre() const noexcept(true) { return this->pre_; }
+
+  ///
+  ///\brief Get the outgoing arcs of all transitions
+  ///
+  [[nodiscard]] const Incidence &post() const noexcept(true) { return this->post_; }
+
+  ///
+  ///\brief Check if the net is acyclic
+  ///
+  [[nodiscard]] bool acyclic() const noexcept(true) {
+    return this->topological_order_.size() == this->transitionCount();
+  }
+
+  ///
+  ///\brief Get all transitions in topological order (empty if the net is not acyclic)
+  ///
+  [[nodiscard]] const std::vector<PosT> &topologicalOrder() const noexcept(true) {
+    return this->topological_order_;
+  }
+
+  ///
+  ///\brief Get the number of colors of the conflict graph (0 without transitions)
+  ///
+  [[nodiscard]] std::size_t colorCount() const noexcept(true) {
+    return this->color_offsets_.empty() ? 0 : this->color_offsets_.size() - 1;
+  }
+
+  ///
+  ///\brief Get the transitions of one color (pairwise free of conflicts)
+  ///
+  ///\param color the color
+  ///\return std::pair<const PosT *, const PosT *> [begin, end) of the transition indices
+  /// (ascending)
+  ///
+  [[nodiscard]] std::pair<const PosT *, const PosT *> colorClass(std::size_t color) const
+      noexcept(true) {
+    const auto *base = this->colored_.data();
+    return {base + this->color_offsets_[color], base + this->color_offsets_[color + 1]};
+  }
+
+  ///
+  ///\brief Get the transitions a place is ingoing to
+  ///
+  ///\param place the place index
+  ///\return std::pair<const PosT *, const PosT *> [begin, end) of the transition indices
+  ///
+  [[nodiscard]] std::pair<const PosT *, const PosT *> consumers(std::size_t place) const
+      noexcept(true) {
+    const auto *base = this->consumers_.data();
+    return {base + this->consumer_offsets_[place], base + this->consumer_offsets_[place + 1]};
+  }
+
+  ///
+  ///\brief Get the weights of the arcs from a place to its consumers
+  ///
+  ///\param place the place index
+  ///\return const TokenCounterT * the weights, parallel to consumers(place)
+  ///
+  [[nodiscard]] const TokenCounterT *consumerWeights(std::size_t place) const noexcept(true) {
+    return this->consumer_weights_.data() + this->consumer_offsets_[place];
+  }
+
+  ///
+  ///\brief Check if a transition is ready
+  ///
+  ///\param marking the marking (indexed by place index)
+  ///\param t the transition index
+  ///
+  [[nodiscard]] bool ready(const TokenCounterT *marking, std::size_t t) const noexcept(true) {
+    for (auto k = this->pre_.offsets[t]; k < this->pre_.offsets[t + 1]; ++k) {
+      if (marking[this->pre_.places[k]] < this->pre_.weights[k]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  ///
+  ///\brief Check which transitions are ready, for a whole marking at once
+  ///
+  /// Evaluates all arcs in chunks with the fastest kernel of the CPU (AVX2 or SSE4.1 for
+  /// uint32_t tokens, scalar otherwise) and reduces them per transition.
+  ///
+  ///\param marking the marking (indexed by place index)
+  ///\param mask receives bit t % 64 of word t / 64 set if transition t is ready
+  ///\param kernel the kernel to use (falls back to the scalar kernel if not supported)
+  ///
+  void readyMask(const TokenCounterT *marking, std::vector<std::uint64_t> &mask,
+                 kernels::Kernel kernel = kernels::detect()) const noexcept(false) {
+    constexpr std::size_t k_chunk_words = 64;
+    constexpr std::size_t k_chunk_arcs = 64 * k_chunk_words;
+
+    auto rows = this->transitionCount();
+    mask.assign((rows + 63) / 64, 0);
+    if (this->placeCount() > static_cast<std::size_t>(std::numeric_limits<std::int32_t>::max())) {
+      kernel = kernels::Kernel::k_scalar;  // Gathers use signed indices
+    }
+
+    const auto &offsets = this->pre_.offsets;
+    std::uint64_t unsatisfied[k_chunk_words] = {};
+    std::size_t t = 0;
+    bool pending = false;  // the current row has an unsatisfied arc in an earlier chunk
+
+    // Reduce all rows ending inside the chunk [begin, end)
+    auto reduce = [&](std::size_t begin, std::size_t end) {
+      while (t < rows && offsets[t + 1] <= end) {
+        auto from = std::max<std::size_t>(offsets[t], begin);
+        if (!pending && !anyBit(unsatisfied, from - begin, offsets[t + 1] - begin)) {
+          mask[t / 64] |= std::uint64_t{1} << (t % 64);
+        }
+        pending = false;
+        ++t;
+      }
+      if (t < rows) {
+        auto from = std::max<std::size_t>(offsets[t], begin);
+        pending = pending || anyBit(unsatisfied, from - begin, end - begin);
+      }
+    };
+
+    auto arcs = this->pre_.places.size();
+    for (std::size_t begin = 0; begin < arcs; begin += k_chunk_arcs) {
+      auto end = std::min(arcs, begin + k_chunk_arcs);
+      std::fill(std::begin(unsatisfied), std::end(unsatisfied), 0);
+      kernels::unsatisfiedArcs(kernel, marking, this->pre_.places.data() + begin,
+                               this->pre_.weights.data() + begin, end - begin, unsatisfied);
+      reduce(begin, end);
+    }
+    // Rows without arcs after the last arc
+    reduce(arcs, arcs);
+  }
+
+  ///
+  ///\brief Remove the tokens of the ingoing arcs of a transition without checking if it is ready
+  ///
+  ///\param marking the marking (indexed by place index)
+  ///\param t the transition index
+  ///\param on_change called as on_change(place, prev_tokens) after a place was changed
+  ///
+  template <typename OnChange>
+  void consume(TokenCounterT *marking, std::size_t t, OnChange &&on_change) const {
+    for (auto k = this->pre_.offsets[t]; k < this->pre_.offsets[t + 1]; ++k) {
+      auto &tokens = marking[this->pre_.places[k]];
+      auto prev = tokens;
+      tokens = tokens - this->pre_.weights[k];
+      on_change(this->pre_.places[k], prev);
+    }
+  }
+
+  ///
+  ///\brief Add the tokens of the outgoing arcs of a transition
+  ///
+  ///\param marking the marking (indexed by place index)
+  ///\param t the transition index
+  ///\param on_change called as on_change(place, prev_tokens) after a place was changed
+  ///
+  template <typename OnChange>
+  void produce(TokenCounterT *marking, std::size_t t, OnChange &&on_change) const {
+    for (auto k = this->post_.offsets[t]; k < this->post_.offsets[t + 1]; ++k) {
+      auto &tokens = marking[this->post_.places[k]];
+      auto prev = tokens;
+      tokens = tokens + this->post_.weights[k];
+      on_change(this->post_.places[k], prev);
+    }
+  }
+
+  ///
+  ///\brief Apply the token changes of a transition without checking if it is ready
+  ///
+  ///\param marking the marking (indexed by place index)
+  ///\param t the transition index
+  ///\param on_change called as on_change(place, prev_tokens) after a place was changed
+  ///
+  template <typename OnChange>
+  void apply(TokenCounterT *marking, std::size_t t, OnChange &&on_change) const {
+    this->consume(marking, t, on_change);
+    this->produce(marking, t, on_change);
+  }
+
+  ///
+  ///\brief Fire a transition if it is ready
+  ///
+  ///\param marking the marking (indexed by place index)
+  ///\param t the transition index
+  ///\param on_change called as on_change(place, prev_tokens) after a place was changed
+  ///\return true fired
+  ///\return false not ready
+  ///
+  template <typename OnChange>
+  bool fire(TokenCounterT *marking, std::size_t t, OnChange &&on_change) const {
+    if (!this->ready(marking, t)) {
+      return false;
+    }
+
+    this->apply(marking, t, std::forward<OnChange>(on_change));
+    return true;
+  }
+};
+
+}  // namespace sptn
+
+#endif  // SIMPLEPTN_INCLUDE_SIMPLEPTN_COMPILED_NET_HPP_
@@ -0,0 +1,153 @@
+// Copyright Open Logistics Foundation
+// 
+// Licensed under the Open Logistics Foundation License 1.3.
+// For details on the licensing terms, see the LICENSE file.
+// SPDX-License-Identifier: OLFL-1.3
+// 
+// This file contains the IdIndex class
+
+#ifndef SIMPLEPTN_INCLUDE_SIMPLEPTN_ID_INDEX_HPP_
+#define SIMPLEPTN_INCLUDE_SIMPLEPTN_ID_INDEX_HPP_
+
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <map>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+namespace sptn {
+
+///
+///\brief Detects whether std::hash is enabled for T
+///
+template <typename T, typename = void> struct IsHashable : std::false_type {};
+
+template <typename T>
+struct IsHashable<T, std::void_t<decltype(std::hash<T>{}(std::declval<const T &>()))>>
+    : std::true_type {};
+
+///
+///\brief The key type stored by IdIndex for an ID type
+///
+/// std::basic_string IDs are stored as views onto the ID owned by the node, so they can be
+/// looked up by std::basic_string_view or character arrays without allocating.
+///
+template <typename T> struct IdIndexKey { using type = T; };
+
+template <typename C, typename Tr, typename A> struct IdIndexKey<std::basic_string<C, Tr, A>> {
+  using type = std::basic_string_view<C, Tr>;
+};
+
+///
+///\brief Maps IDs to positions inside the node storage of a PetriNet
+///
+/// A hash map is used if std::hash is available for IDT, otherwise the
+/// index falls back to an ordered map (requires operator<).
+///
+/// Lookups are transparent: the hash map accepts every type its key is constructible
+/// from (e.g. std::string_view for std::string IDs), the ordered map every type comparable to
+/// IDT.
+///
+///\tparam IDT the ID type (must overload operator==, operator< or be hashable)
+///
+template <typename ID> class IdIndex {
+public:
+  using IDT = ID;
+  using KeyT = typename IdIndexKey<IDT>::type;
+
+  ///\brief returned by find() if the ID is unknown
+  static constexpr std::size_t k_npos = std::numeric_limits<std::size_t>::max();
+
+private:
+  static constexpr bool k_hashed = IsHashable<KeyT>::value;
+
+  using MapT = std::conditional_t<k_hashed, std::unordered_map<KeyT, std::size_t>,
+                                  std::map<KeyT, std::size_t, std::less<>>>;
+  MapT map_;
+
+  template <typename K, typename = void> struct IsComparable : std::false_type {};
+  template <typename K>
+  using LessT = decltype(std::declval<const KeyT &>() < std::declval<const K &>(),
+                         std::declval<const K &>() < std::declval<const KeyT &>());
+  template <typename K> struct IsComparable<K, std::void_t<LessT<K>>> : std::true_type {};
+
+public:
+  ///\brief true if K can be used for lookups
+  template <typename K>
+  static constexpr bool k_is_lookup_key =
+      k_hashed ? std::is_constructible_v<KeyT, const K &> : IsComparable<K>::value;
+
+  ///
+  ///\brief Find the position stored for an ID
+  ///
+  ///\param id the ID (or a type usable for lookups) to search for
+  ///\return std::size_t the position or k_npos if not found
+  ///
+  template <typename K> [[nodiscard]] std::size_t find(const K &id) const noexcept(true) {
+    auto it = this->lookup(id);
+    return it != cend(this->map_) ? it->second : k_npos;
+  }
+
+  ///
+  ///\brief Check if an ID is part of the index
+  ///
+  template <typename K> [[nodiscard]] bool contains(const K &id) const noexcept(true) {
+    return this->lookup(id) != cend(this->map_);
+  }
+
+  ///
+  ///\brief Insert a new ID
+  ///
+  /// NOTE: the index may keep a view onto id, it has to stay valid as long as it is indexed
+  ///
+  ///\param id the ID (owned by the node)
+  ///\param pos the position of the node with this ID
+  ///\return false if the ID already existed (the index is unchanged)
+  ///
+  bool insert(const IDT &id, std::size_t pos) noexcept(false) {
+    return this->map_.emplace(KeyT(id), pos).second;
+  }
+
+  ///
+  ///\brief Remove an ID (no-op if it does not exist)
+  ///
+  void erase(const IDT &id) noexcept(true) { this->map_.erase(KeyT(id)); }
+
+  ///
+  ///\brief Prepare the index for n IDs (no-op for the ordered fallback)
+  ///
+  void reserve(std::size_t n) noexcept(false) {
+    if constexpr (k_hashed) {
+      this->map_.reserve(n);
+    }
+  }
+
+  ///
+  ///\brief Remove all IDs
+  ///
+  void clear() noexcept(true) { this->map_.clear(); }
+
+  ///
+  ///\brief Get the number of IDs
+  ///
+  [[nodiscard]] std::size_t size() const noexcept(true) { return this->map_.size(); }
+
+private:
+  template <typename K> auto lookup(const K &id) const noexcept(true) {
+    static_assert(k_is_lookup_key<K>, "Type can not be used to look up IDs");
+    if constexpr (std::is_same_v<K, KeyT> || !k_hashed) {
+      return this->map_.find(id);
+    } else {
+      // Views the ID if KeyT is a string_view (no allocation)
+      return this->map_.find(KeyT(id));
+    }
+  }
+};
+
+}  // namespace sptn
+
+#endif  // SIMPLEPTN_INCLUDE_SIMPLEPTN_ID_INDEX_HPP_
@@ -0,0 +1,132 @@
+// Copyright Open Logistics Foundation
+// 
+// Licensed under the Open Logistics Foundation License 1.3.
+// For details on the licensing terms, see the LICENSE file.
+// SPDX-License-Identifier: OLFL-1.3
+// 
+// This file contains the NetMutex class
+
+#ifndef SIMPLEPTN_INCLUDE_SIMPLEPTN_NET_MUTEX_HPP_
+#define SIMPLEPTN_INCLUDE_SIMPLEPTN_NET_MUTEX_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <shared_mutex>
+#include <thread>
+
+namespace sptn {
+
+///
+///\brief Shared mutex of a net, which additionally lets atomic firings in without touching it
+///
+/// Taking a std::shared_mutex in shared mode writes its reader count, so firings of disjoint
+/// places on different cores still contend for that cache line. Once enableFastPath() was
+/// called, a fast reader only increments a counter of its own (one of k_slots, picked per
+/// thread) and checks that no writer is present. An exclusive lock raises the writer flag and
+/// waits for all counters to drain, so fast readers never see the structure change. While a
+/// writer is present, fast readers fall back to the shared lock.
+///
+/// Usable with std::lock_guard, std::unique_lock and std::shared_lock like std::shared_mutex.
+///
+class NetMutex {
+  static constexpr std::size_t k_slots = 64;
+
+  ///\brief a counter of fast readers on a cache line of its own
+  struct alignas(64) Slot {
+    std::atomic<std::size_t> readers{0};
+  };
+
+  std::shared_mutex mutex_;
+  std::atomic<bool> writer_{false};
+  bool fast_path_ = false;
+  Slot slots_[k_slots];
+
+  static std::size_t threadSlot() noexcept(true) {
+    static std::atomic<std::size_t> next{0};
+    thread_local std::size_t slot = next.fetch_add(1, std::memory_order_relaxed) % k_slots;
+    return slot;
+  }
+
+public:
+  NetMutex() = default;
+  NetMutex(const NetMutex &) = delete;
+  NetMutex &operator=(const NetMutex &) = delete;
+
+  ///
+  ///\brief Allow enterFast() (call before the mutex is shared between threads)
+  ///
+  void enableFastPath() noexcept(true) { this->fast_path_ = true; }
+
+  void lock() noexcept(false) {
+    this->mutex_.lock();
+    if (this->fast_path_) {
+      this->writer_.store(true);
+      for (auto &slot : this->slots_) {
+        while (slot.readers.load() != 0) {
+          std::this_thread::yield();
+        }
+      }
+    }
+  }
+
+  void unlock() noexcept(true) {
+    if (this->fast_path_) {
+      this->writer_.store(false);
+    }
+    this->mutex_.unlock();
+  }
+
+  void lock_shared() noexcept(false) { this->mutex_.lock_shared(); }
+  void unlock_shared() noexcept(true) { this->mutex_.unlock_shared(); }
+
+  ///
+  ///\brief Enter as a reader without touching the shared mutex (requires enableFastPath())
+  ///
+  /// Falls back to the shared lock while a writer is present.
+  ///
+  ///\return std::size_t the token to pass to exitFast()
+  ///
+  std::size_t enterFast() noexcept(false) {
+    auto slot = threadSlot();
+    auto &readers = this->slots_[slot].readers;
+    readers.fetch_add(1);
+    if (!this->writer_.load()) {
+      return slot;
+    }
+    readers.fetch_sub(1);
+    this->mutex_.lock_shared();
+    return k_slots;
+  }
+
+  ///
+  ///\brief Leave after enterFast()
+  ///
+  ///\param token the result of enterFast()
+  ///
+  void exitFast(std::size_t token) noexcept(true) {
+    if (token == k_slots) {
+      this->mutex_.unlock_shared();
+    } else {
+      this->slots_[token].readers.fetch_sub(1);
+    }
+  }
+};
+
+///
+///\brief Holds NetMutex::enterFast() for a scope
+///
+class FastReadLock {
+  NetMutex &mutex_;
+  std::size_t token_;
+
+public:
+  explicit FastReadLock(NetMutex &mutex) noexcept(false)
+      : mutex_(mutex), token_(mutex.enterFast()) {}
+  FastReadLock(const FastReadLock &) = delete;
+  FastReadLock &operator=(const FastReadLock &) = delete;
+  ~FastReadLock() { this->mutex_.exitFast(this->token_); }
+};
+
+}  // namespace sptn
+
+#endif  // SIMPLEPTN_INCLUDE_SIMPLEPTN_NET_MUTEX_HPP_
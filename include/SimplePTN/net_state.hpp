@@ -0,0 +1,537 @@
+// Copyright Open Logistics Foundation
+// 
+// Licensed under the Open Logistics Foundation License 1.3.
+// For details on the licensing terms, see the LICENSE file.
+// SPDX-License-Identifier: OLFL-1.3
+// 
+// This file contains the NetState class
+
+#ifndef SIMPLEPTN_INCLUDE_SIMPLEPTN_NET_STATE_HPP_
+#define SIMPLEPTN_INCLUDE_SIMPLEPTN_NET_STATE_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "atomic_ops.hpp"
+#include "compiled_net.hpp"
+#include "net_mutex.hpp"
+
+namespace sptn {
+
+template <typename A, typename B> class Place;
+template <typename A, typename B> class Transition;
+
+///
+///\brief The state shared by a PetriNet and all of its Places and Transitions
+///
+/// The state owns all Places and Transitions of the net, which only reference each other and
+/// the state by raw pointers. Pointers handed out by the PetriNet share the ownership of the
+/// state, so destroying the last owner releases the whole net at once.
+///
+/// Nodes and their arc storage are allocated from a monotonic arena (bump pointer allocation,
+/// nothing is freed before the state is destroyed).
+///
+/// If place_locks is set, firing a transition only takes the shared lock of mutex plus the locks
+/// of its places, \see sptn::Locking. The tracked state is updated like with atomic_tokens if
+/// atomic_tracking is set, else under tracking_mutex.
+/// If atomic_tokens is set, firing only enters mutex by NetMutex::enterFast() (no shared write)
+/// and changes the marking, deficits and dirty_flags with atomic instructions. enabled and dirty are rebuilt from them
+/// by the next operation holding the exclusive lock (tracking_stale).
+/// If place_versions is set as well, firing reads the tokens without locking and commits by
+/// locking the versions it read (so a firing in between makes the commit fail and retry).
+///
+/// If track_changes is set, the number of unsatisfied ingoing arcs of every transition and the
+/// set of enabled transitions are updated whenever tokens change, so checking readiness is O(1).
+/// Additionally, all transitions with a changed ingoing place are queued as dirty.
+///
+/// Objects of this class shall not be instanciated directly, \see sptn::PetriNet
+///
+///\tparam IDT the ID type
+///\tparam TokenCounterT the counting type
+///
+template <typename ID = std::string, typename TokenCounter = uint32_t> struct NetState {
+  using IDT = ID;
+  using TokenCounterT = TokenCounter;
+  using PlaceT = Place<IDT, TokenCounterT>;
+  using TransitionT = Transition<IDT, TokenCounterT>;
+
+  ///\brief guards the structure of the net and the marking (atomic firings enter it by
+  /// NetMutex::enterFast())
+  mutable NetMutex mutex;
+
+  ///\brief the number of locks the places are distributed over (when locking places)
+  static constexpr std::size_t k_place_lock_stripes = 256;
+
+  ///\brief Transitions with more arcs take mutex exclusively instead of locking their places
+  /// (one lock is cheaper than that many)
+  static constexpr std::size_t k_max_place_locks = 16;
+
+  ///\brief the locks of the places, place p uses p % k_place_lock_stripes (nullptr if firing
+  /// takes mutex exclusively)
+  std::unique_ptr<std::mutex[]> place_locks;
+
+  ///\brief guards deficits, enabled and dirty while firings hold only the shared lock of mutex
+  /// (only used with place_locks and without atomic_tracking)
+  std::mutex tracking_mutex;
+
+  ///\brief whether firings holding only the shared lock of mutex update deficits and
+  /// dirty_flags atomically (tokensChangedAtomic()), so they do not serialize on tracking_mutex
+  bool atomic_tracking = false;
+
+  ///\brief whether atomic firings are possible (integral tokens and a supported compiler)
+  static constexpr bool k_atomic_tokens_supported =
+      atomics::k_supported && std::is_integral_v<TokenCounterT>;
+
+  ///\brief whether firings change the marking atomically instead of locking
+  bool atomic_tokens = false;
+
+  ///\brief the versions of the places, place p uses p % k_place_lock_stripes (odd while a
+  /// firing commits, nullptr unless firing optimistically)
+  std::unique_ptr<std::uint64_t[]> place_versions;
+
+  ///\brief set by atomic firings, enabled and dirty do not reflect deficits and dirty_flags
+  std::atomic<bool> tracking_stale{false};
+
+  ///\brief the resource the arena requests its memory from
+  std::pmr::memory_resource *upstream;
+
+  ///\brief the arena of all nodes and arcs (only allocate while holding the exclusive lock)
+  std::pmr::monotonic_buffer_resource arena;
+
+  ///\brief all places, indexed by PlaceIndex (allocated from the arena)
+  std::vector<PlaceT *> places;
+
+  ///\brief all transitions, indexed by TransitionIndex (allocated from the arena)
+  std::vector<TransitionT *> transitions;
+
+  ///\brief the tokens of all places, indexed by PlaceIndex
+  std::vector<TokenCounterT> marking;
+
+  ///\brief the flat incidence representation (nullptr if not compiled or outdated)
+  std::shared_ptr<const CompiledNet<TokenCounterT>> compiled;
+
+  ///\brief whether deficits, enabled and dirty are maintained (set by the owning PetriNet)
+  bool track_changes = false;
+
+  ///\brief the number of unsatisfied ingoing arcs, indexed by TransitionIndex
+  std::vector<std::size_t> deficits;
+
+  ///\brief all transitions with a deficit of 0 (unordered)
+  std::vector<std::size_t> enabled;
+
+  ///\brief the position of each transition inside enabled (k_not_enabled if not enabled)
+  std::vector<std::size_t> enabled_pos;
+
+  static constexpr std::size_t k_not_enabled = std::numeric_limits<std::size_t>::max();
+
+  ///\brief transitions to re-evaluate on the next dirty tick (each at most once)
+  std::vector<std::size_t> dirty;
+
+  ///\brief whether a transition is contained in dirty, indexed by TransitionIndex (bytes, so
+  /// atomic firings can set them)
+  std::vector<std::uint8_t> dirty_flags;
+
+  ///
+  ///\brief The reusable storage of a deepTick traversal
+  ///
+  /// A place is on the current path if its stamp equals the epoch of the traversal, so marks of
+  /// earlier (also aborted) traversals never have to be cleared.
+  ///
+  struct DeepTickScratch {
+    ///\brief a place with its next consumer or a fired transition with its next outgoing place
+    struct Frame {
+      std::size_t node;
+      std::size_t next;
+      bool is_place;
+    };
+
+    std::vector<Frame> stack;
+    std::vector<std::uint64_t> stamps;
+    std::uint64_t epoch = 0;
+  };
+
+  ///\brief guards deep_tick_scratch (only held during a deepTick, not by fire() or tick())
+  std::mutex deep_tick_mutex;
+
+  ///\brief the storage reused by deepTick
+  DeepTickScratch deep_tick_scratch;
+
+  ///
+  ///\brief Construct a new NetState
+  ///
+  ///\param upstream the resource the arena requests its memory from
+  ///
+  explicit NetState(std::pmr::memory_resource *upstream = std::pmr::get_default_resource())
+      : upstream(upstream), arena(upstream) {}
+
+  NetState(const NetState &) = delete;
+  NetState &operator=(const NetState &) = delete;
+
+  ///
+  ///\brief Destroy all nodes, the arena releases their memory at once
+  ///
+  ~NetState() {
+    for (auto *transition : this->transitions) {
+      transition->~TransitionT();
+    }
+    for (auto *place : this->places) {
+      place->~PlaceT();
+    }
+  }
+
+  ///
+  ///\brief Check if firing locks the places instead of taking mutex exclusively
+  ///
+  bool locksPlaces() const noexcept(true) { return this->place_locks != nullptr; }
+
+  ///
+  ///\brief Check if firing validates the versions of the places instead of locking them
+  ///
+  bool validatesVersions() const noexcept(true) { return this->place_versions != nullptr; }
+
+  ///
+  ///\brief Get the position of the lock (or version) of a place (only with place_locks or
+  /// place_versions)
+  ///
+  static std::size_t placeStripe(std::size_t place) noexcept(true) {
+    return place % k_place_lock_stripes;
+  }
+
+  ///
+  ///\brief Lock the tokens of a place for reading (in addition to the shared lock of mutex)
+  ///
+  ///\return std::unique_lock<std::mutex> owns no mutex unless locking places
+  ///
+  std::unique_lock<std::mutex> lockPlace(std::size_t place) noexcept(false) {
+    if (!this->locksPlaces()) {
+      return {};
+    }
+    return std::unique_lock(this->place_locks[placeStripe(place)]);
+  }
+
+  ///
+  ///\brief Lock deficits, enabled and dirty for reading (in addition to the shared lock of mutex)
+  ///
+  ///\return std::unique_lock<std::mutex> owns no mutex unless locking places without
+  /// atomic_tracking
+  ///
+  std::unique_lock<std::mutex> lockTracking() noexcept(false) {
+    if (!this->locksPlaces() || this->atomic_tracking) {
+      return {};
+    }
+    return std::unique_lock(this->tracking_mutex);
+  }
+
+  ///
+  ///\brief Read the tokens of a place (requires at least the shared lock of mutex and the lock
+  /// of the place)
+  ///
+  TokenCounterT loadTokens(std::size_t place) const noexcept(true) {
+    if constexpr (k_atomic_tokens_supported) {
+      if (this->atomic_tokens) {
+        return atomics::load(this->marking[place]);
+      }
+    }
+    return this->marking[place];
+  }
+
+  ///
+  ///\brief Read the number of unsatisfied ingoing arcs of a transition (requires at least the
+  /// shared lock of mutex and lockTracking())
+  ///
+  std::size_t loadDeficit(std::size_t transition) const noexcept(true) {
+    if constexpr (atomics::k_supported) {
+      if (this->atomic_tracking) {
+        return atomics::load(this->deficits[transition]);
+      }
+    }
+    return this->deficits[transition];
+  }
+
+  ///
+  ///\brief Call fn with the position of every enabled transition (requires at least the shared
+  /// lock of mutex and lockTracking())
+  ///
+  /// Scans all deficits in ascending order while atomic firings left enabled outdated.
+  ///
+  template <typename Fn> void forEachEnabled(Fn fn) const {
+    if (this->tracking_stale.load(std::memory_order_acquire)) {
+      for (std::size_t transition = 0; transition < this->deficits.size(); ++transition) {
+        if (this->loadDeficit(transition) == 0) {
+          fn(transition);
+        }
+      }
+      return;
+    }
+    for (auto transition : this->enabled) {
+      fn(transition);
+    }
+  }
+
+  ///
+  ///\brief Rebuild enabled and dirty after atomic firings (requires the exclusive lock of mutex)
+  ///
+  /// Called by every operation changing the tracked state, so it only has to be called before
+  /// reading enabled or dirty directly.
+  ///
+  void syncTracking() noexcept(true) {
+    if (!this->tracking_stale.load(std::memory_order_relaxed)) {
+      return;
+    }
+    this->tracking_stale.store(false, std::memory_order_relaxed);
+
+    // Both vectors have the capacity of all transitions (reserved by pushDeficit())
+    this->enabled.clear();
+    this->dirty.clear();
+    for (std::size_t transition = 0; transition < this->deficits.size(); ++transition) {
+      this->enabled_pos[transition] = k_not_enabled;
+      if (this->deficits[transition] == 0) {
+        this->enable(transition);
+      }
+      if (this->dirty_flags[transition]) {
+        this->dirty.push_back(transition);
+      }
+    }
+  }
+
+  ///
+  ///\brief Allocate uninitialized memory for a node from the arena
+  ///
+  ///\tparam T the node type
+  ///\return void* memory for one T
+  ///
+  template <typename T> void *allocate() noexcept(false) {
+    return this->arena.allocate(sizeof(T), alignof(T));
+  }
+
+  ///
+  ///\brief Start tracking the next transition
+  ///
+  ///\param deficit the number of its unsatisfied ingoing arcs
+  ///
+  void pushDeficit(std::size_t deficit) noexcept(false) {
+    this->syncTracking();
+    // Reserve everything first, so the state stays consistent if an allocation fails
+    auto grow = [](auto &vec) {
+      if (vec.size() == vec.capacity()) {
+        vec.reserve(2 * vec.size() + 1);
+      }
+    };
+    grow(this->deficits);
+    grow(this->enabled_pos);
+    grow(this->dirty_flags);
+    for (auto *queue : {&this->enabled, &this->dirty}) {
+      if (queue->capacity() < this->deficits.size() + 1) {
+        queue->reserve(this->deficits.capacity());
+      }
+    }
+    this->deficits.push_back(deficit);
+    this->enabled_pos.push_back(k_not_enabled);
+    this->dirty_flags.push_back(0);
+    if (deficit == 0) {
+      this->enable(this->deficits.size() - 1);
+    }
+    this->markDirty(this->deficits.size() - 1);
+  }
+
+  ///
+  ///\brief Stop tracking the last transition
+  ///
+  void popDeficit() noexcept(true) {
+    this->syncTracking();
+    auto transition = this->deficits.size() - 1;
+    this->disable(transition);
+    if (this->dirty_flags[transition]) {
+      this->dirty.erase(std::find(begin(this->dirty), end(this->dirty), transition));
+    }
+    this->deficits.pop_back();
+    this->enabled_pos.pop_back();
+    this->dirty_flags.pop_back();
+  }
+
+  ///
+  ///\brief Queue a transition for the next dirty tick
+  ///
+  ///\param transition the transition position
+  ///
+  void markDirty(std::size_t transition) noexcept(true) {
+    this->syncTracking();
+    if (!this->dirty_flags[transition]) {
+      this->dirty_flags[transition] = 1;
+      this->dirty.push_back(transition);  // capacity reserved by pushDeficit()
+    }
+  }
+
+  ///
+  ///\brief Tick all transitions reachable from a place depth-first, without recursion
+  ///
+  /// The consumers of a place are ticked in order, the outgoing places of each fired
+  /// transition are visited before its next sibling. Reuses deep_tick_scratch, so the
+  /// traversal does not allocate once the storage has grown (concurrent or nested traversals
+  /// fall back to temporary storage).
+  ///
+  /// The graph provides placeCount(), consumerCount(place), consumer(place, i),
+  /// outputCount(transition), output(transition, i) and tick(transition) -> bool fired.
+  ///
+  ///\param start the start place position
+  ///\param graph the adjacency of the net
+  ///\throws std::runtime_error if a place is reached twice on one path (cycle detected)
+  ///
+  template <typename Graph> void deepTick(std::size_t start, Graph &graph) noexcept(false) {
+    std::unique_lock lock(this->deep_tick_mutex, std::try_to_lock);
+    if (lock.owns_lock()) {
+      deepTick(start, graph, this->deep_tick_scratch);
+    } else {
+      DeepTickScratch scratch;
+      deepTick(start, graph, scratch);
+    }
+  }
+
+  ///
+  ///\brief Update the deficit of a transition after one of its ingoing arcs changed
+  ///
+  ///\param transition the transition position
+  ///\param satisfied whether the arc is satisfied now (and was not before)
+  ///
+  void arcChanged(std::size_t transition, bool satisfied) noexcept(true) {
+    this->syncTracking();
+    auto &deficit = this->deficits[transition];
+    if (satisfied) {
+      if (--deficit == 0) {
+        this->enable(transition);
+      }
+    } else if (deficit++ == 0) {
+      this->disable(transition);
+    }
+  }
+
+  ///
+  ///\brief Update the deficits and dirty queue after the tokens of an ingoing arc changed
+  ///
+  ///\param transition the transition position
+  ///\param weight the weight of the arc
+  ///\param prev the previous tokens of the place
+  ///\param tokens the current tokens of the place
+  ///
+  void tokensChanged(std::size_t transition, const TokenCounterT &weight,
+                     const TokenCounterT &prev, const TokenCounterT &tokens) noexcept(true) {
+    this->markDirty(transition);
+
+    bool was_satisfied = !(prev < weight);
+    bool is_satisfied = !(tokens < weight);
+    if (was_satisfied != is_satisfied) {
+      this->arcChanged(transition, is_satisfied);
+    }
+  }
+
+  ///
+  ///\brief Update the deficits and dirty flags after an atomic firing changed the tokens of an
+  /// ingoing arc (requires the shared lock of mutex or NetMutex::enterFast(), sets
+  /// tracking_stale)
+  ///
+  /// Every change is counted separately, so the deficits are exact once all concurrent changes
+  /// are counted (until then a deficit may wrap around for a moment).
+  ///
+  ///\param transition the transition position
+  ///\param weight the weight of the arc
+  ///\param prev the previous tokens of the place
+  ///\param tokens the current tokens of the place
+  ///
+  void tokensChangedAtomic(std::size_t transition, const TokenCounterT &weight,
+                           const TokenCounterT &prev, const TokenCounterT &tokens) noexcept(true) {
+    if constexpr (atomics::k_supported) {
+      auto &flag = this->dirty_flags[transition];
+      if (atomics::load(flag) == 0) {
+        atomics::store(flag, std::uint8_t{1});
+      }
+
+      bool was_satisfied = !(prev < weight);
+      bool is_satisfied = !(tokens < weight);
+      if (was_satisfied != is_satisfied) {
+        auto &deficit = this->deficits[transition];
+        if (is_satisfied) {
+          atomics::fetchSub(deficit, std::size_t{1});
+        } else {
+          atomics::fetchAdd(deficit, std::size_t{1});
+        }
+      }
+      if (!this->tracking_stale.load(std::memory_order_relaxed)) {
+        this->tracking_stale.store(true, std::memory_order_release);
+      }
+    }
+  }
+
+private:
+  template <typename Graph>
+  static void deepTick(std::size_t start, Graph &graph, DeepTickScratch &scratch) noexcept(
+      false) {
+    auto epoch = ++scratch.epoch;
+    if (scratch.stamps.size() < graph.placeCount()) {
+      scratch.stamps.resize(graph.placeCount(), 0);
+    }
+    auto &stack = scratch.stack;
+    stack.clear();
+
+    auto enter = [&](std::size_t place) {
+      if (scratch.stamps[place] == epoch) {
+        throw std::runtime_error("Cycle detected");
+      }
+      scratch.stamps[place] = epoch;
+      stack.push_back({place, 0, true});
+    };
+
+    enter(start);
+    while (!stack.empty()) {
+      auto &frame = stack.back();
+      if (frame.is_place) {
+        if (frame.next == graph.consumerCount(frame.node)) {
+          scratch.stamps[frame.node] = 0;  // leave the path
+          stack.pop_back();
+          continue;
+        }
+        auto transition = graph.consumer(frame.node, frame.next++);
+        if (graph.tick(transition)) {
+          stack.push_back({transition, 0, false});
+        }
+      } else {
+        if (frame.next == graph.outputCount(frame.node)) {
+          stack.pop_back();
+          continue;
+        }
+        enter(graph.output(frame.node, frame.next++));
+      }
+    }
+  }
+
+  void enable(std::size_t transition) noexcept(true) {
+    this->enabled_pos[transition] = this->enabled.size();
+    this->enabled.push_back(transition);  // capacity reserved by pushDeficit()
+  }
+
+  void disable(std::size_t transition) noexcept(true) {
+    auto pos = this->enabled_pos[transition];
+    if (pos == k_not_enabled) {
+      return;
+    }
+    // Swap with the last enabled transition
+    this->enabled[pos] = this->enabled.back();
+    this->enabled_pos[this->enabled[pos]] = pos;
+    this->enabled.pop_back();
+    this->enabled_pos[transition] = k_not_enabled;
+  }
+};
+
+}  // namespace sptn
+
+#endif  // SIMPLEPTN_INCLUDE_SIMPLEPTN_NET_STATE_HPP_
@@ -10,25 +10,57 @@
 #define THIRD_PARTY_SIMPLEPTN_INCLUDE_SIMPLEPTN_PETRI_NET_HPP_
 
 #include <algorithm>
+#include <limits>
 #include <memory>
-#include <set>
+#include <memory_resource>
+#include <mutex>
+#include <new>
 #include <shared_mutex>
 #include <stdexcept>
 #include <string>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+#include "compiled_net.hpp"
+#include "id_index.hpp"
+#include "net_state.hpp"
 #include "place.hpp"
+#include "thread_pool.hpp"
 #include "transition.hpp"
+#include "transition_set.hpp"
 
 namespace sptn {
 
+///
+///\brief How firing a Transition is synchronized
+///
+enum class Locking {
+  ///\brief every firing locks the whole net exclusively
+  k_net,
+  ///\brief a firing only locks the Places of the Transition, so Transitions without common
+  /// Places fire in parallel (reading the tokens and the enabled Transitions takes an
+  /// additional lock). Transitions with very many arcs lock the whole net instead.
+  k_places,
+  ///\brief a firing changes the tokens with atomic instructions and takes no lock at all, it
+  /// only registers on a counter of its thread (integral tokens only). Concurrent firings competing for tokens may fail while
+  /// another firing gives back reserved tokens, the first operation taking the net lock
+  /// exclusively afterwards rebuilds the enabled Transitions and the dirty queue.
+  k_atomic,
+  ///\brief a firing reads the tokens without locking and commits after validating that no
+  /// other firing changed its Places meanwhile (retrying otherwise), a Transition which is not
+  /// ready writes nothing. Integral tokens only, tracked like k_atomic.
+  k_optimistic
+};
+
 ///
 ///\brief Class representing a PTN
 ///
 /// This is the only class which has to be instanciated by the user.
 /// Places and Transitions are meant to be initialized via this class.
 ///
-///\tparam IDT the ID type (must overload operator== and operator<)
+///\tparam IDT the ID type (must overload operator== and operator<, IDs are indexed by std::hash if
+/// available)
 ///\tparam TokenCounterT the counting type (must overload operator+, operator- and operator<)
 ///
 template <typename ID = std::string, typename TokenCounter = uint32_t> class PetriNet {
@@ -43,8 +75,12 @@ public:
   ///
   /// NOTE: Weight will be subtracted from ingoing places and added to outgoing places
   ///
-  struct TransitionSketch {
-    using SketchWeightPairT = std::pair<IDT, TokenCounterT>;
+  ///\tparam PlaceKeyT the type referencing places (IDT or any type usable for lookups, e.g.
+  /// std::string_view for std::string IDs)
+  ///
+  template <typename PlaceKey = IDT> struct BasicTransitionSketch {
+    using PlaceKeyT = PlaceKey;
+    using SketchWeightPairT = std::pair<PlaceKeyT, TokenCounterT>;
     ///\brief the desired id
     IDT id;
 
@@ -55,26 +91,47 @@ public:
     std::vector<SketchWeightPairT> outgoing;
   };
 
+  using TransitionSketch = BasicTransitionSketch<>;
+
 private:
   using WeightPairT = typename TransitionT::WeightPairT;
-  std::vector<std::shared_ptr<PlaceT>> places_;
-  std::vector<std::shared_ptr<TransitionT>> transitions_;
-  mutable std::shared_ptr<std::shared_mutex> mutex_;
+  using IdIndexT = IdIndex<IDT>;
+  template <typename K>
+  using EnableIfLookupKeyT = std::enable_if_t<IdIndexT::template k_is_lookup_key<K>>;
+  IdIndexT place_index_;
+  IdIndexT transition_index_;
+  using NetStateT = NetState<IDT, TokenCounterT>;
+  using CompiledNetT = CompiledNet<TokenCounterT>;
+  using NotifyListT = typename TransitionT::NotifyListT;
+  std::shared_ptr<NetStateT> state_;
+
+  // Reused while resolving the places of a sketch
+  std::vector<WeightPairT> ingoing_scratch_;
+  std::vector<WeightPairT> outgoing_scratch_;
+
+  ///
+  ///\brief Create a pointer to a node which shares the ownership of the whole net
+  ///
+  ///\param node the node (may be nullptr)
+  ///\return std::shared_ptr<T> keeps the net alive, nullptr if node is nullptr
+  ///
+  template <typename T> std::shared_ptr<T> share(T *node) const noexcept(true) {
+    if (node == nullptr) {
+      return nullptr;
+    }
+    return std::shared_ptr<T>(this->state_, node);
+  }
 
   ///
   ///\brief Find a Place by ID (does not lock the mutex)
   ///
   ///\param id the id to search for
-  ///\return std::shared_ptr<PlaceT> may ne nullptr if not found
+  ///\return PlaceT * may ne nullptr if not found
   ///
-  std::shared_ptr<PlaceT> findPlaceAcquired(const IDT &id) noexcept(true) {
-    auto match_id = [&](std::shared_ptr<PlaceT> place) {
-      return place != nullptr && place->getID() == id;
-    };
-
-    auto it = std::find_if(cbegin(this->places_), cend(this->places_), match_id);
-    if (it != cend(this->places_)) {
-      return *it;
+  template <typename K> PlaceT *findPlaceAcquired(const K &id) const noexcept(true) {
+    auto pos = this->place_index_.find(id);
+    if (pos != IdIndexT::k_npos) {
+      return this->state_->places[pos];
     }
 
     return nullptr;
@@ -84,123 +141,563 @@ private:
   ///\brief Find a Transition by ID (does not lock the mutex)
   ///
   ///\param id the id to search for
-  ///\return std::shared_ptr<TransitionT> may ne nullptr if not found
+  ///\return TransitionT * may ne nullptr if not found
   ///
-  std::shared_ptr<TransitionT> findTransitionAcquired(const IDT &id) noexcept(true) {
-    auto match_id = [&](std::shared_ptr<TransitionT> transition) {
-      return transition != nullptr && transition->getID() == id;
-    };
-
-    auto it = std::find_if(cbegin(this->transitions_), cend(this->transitions_), match_id);
-    if (it != cend(this->transitions_)) {
-      return *it;
+  template <typename K> TransitionT *findTransitionAcquired(const K &id) const noexcept(true) {
+    auto pos = this->transition_index_.find(id);
+    if (pos != IdIndexT::k_npos) {
+      return this->state_->transitions[pos];
     }
 
     return nullptr;
   }
 
+  ///
+  ///\brief Remove all nodes added after the given counts (do not lock the mutex)
+  ///
+  /// Used to undo partially applied additions, the arena memory of the nodes is not reused.
+  ///
+  ///\param place_count the number of places to keep
+  ///\param transition_count the number of transitions to keep
+  ///
+  void rollbackAcquired(std::size_t place_count, std::size_t transition_count) noexcept(true) {
+    auto &transitions = this->state_->transitions;
+    while (transitions.size() > transition_count) {
+      auto *transition = transitions.back();
+      if (this->state_->deficits.size() == transitions.size()) {
+        this->state_->popDeficit();
+      }
+      if (transition != nullptr) {
+        // Neighbour mappings of later transitions were already removed
+        for (auto it = transition->outgoing_.end(); it != transition->outgoing_.begin();) {
+          auto &adjacent = (*--it).place->outgoing_to_;
+          if (!adjacent.empty() && adjacent.back() == transition) {
+            adjacent.pop_back();
+          }
+        }
+        for (auto it = transition->ingoing_.end(); it != transition->ingoing_.begin();) {
+          auto &adjacent = (*--it).place->ingoing_to_;
+          if (!adjacent.empty() && adjacent.back().transition == transition) {
+            adjacent.pop_back();
+          }
+        }
+        this->transition_index_.erase(transition->getID());
+        transition->~TransitionT();
+      }
+      transitions.pop_back();
+    }
+
+    auto &places = this->state_->places;
+    while (places.size() > place_count) {
+      auto *place = places.back();
+      if (place != nullptr) {
+        this->place_index_.erase(place->getID());
+        place->~PlaceT();
+      }
+      places.pop_back();
+      this->state_->marking.pop_back();
+    }
+  }
+
+  ///
+  ///\brief Create a new Place without checking its ID (do not lock the mutex)
+  ///
+  ///\param id the Place's ID (must not exist yet)
+  ///\param initial_tokens the number of initial tokens on this Place
+  ///\return PlaceIndex the handle of the new Place
+  ///
+  PlaceIndex emplacePlaceAcquired(IDT &&id, TokenCounterT initial_tokens) noexcept(false) {
+    auto &places = this->state_->places;
+    auto index = PlaceIndex(places.size());
+    this->state_->compiled.reset();
+    this->state_->marking.push_back(initial_tokens);
+    places.push_back(nullptr);
+    try {
+      places.back() = new (this->state_->template allocate<PlaceT>())
+          PlaceT(std::move(id), index, this->state_.get());
+      this->place_index_.insert(places.back()->getID(), places.size() - 1);
+    } catch (...) {
+      this->rollbackAcquired(places.size() - 1, this->state_->transitions.size());
+      throw;
+    }
+    return index;
+  }
+
   ///
   ///\brief Add a new Place (do not lock the mutex)
   ///
   ///\param id the Place's ID
   ///\param initial_tokens the number of initial tokens on this Place
   ///
+  ///\return PlaceIndex the handle of the new Place
   ///\throws std::invalid_argument if the ID already exists
   ///
-  std::shared_ptr<PlaceT> addPlaceAcquired(const IDT &id,
-                                           TokenCounterT initial_tokens) noexcept(false) {
+  PlaceIndex addPlaceAcquired(IDT id, TokenCounterT initial_tokens) noexcept(false) {
     // Do not allow duplicate IDs
     if (findPlaceAcquired(id) != nullptr) {
       throw std::invalid_argument("PlaceID already exists");
     }
 
-    auto ptr = std::shared_ptr<PlaceT>(new PlaceT(id, initial_tokens));
-    places_.push_back(ptr);
-    return ptr;
+    return this->emplacePlaceAcquired(std::move(id), initial_tokens);
   }
 
   ///
-  ///\brief Add a new Transition (do not lock the mutex)
+  ///\brief Create an empty state which tracks the enabled transitions
   ///
-  ///\param sketch the transition blueprint
+  static std::shared_ptr<NetStateT> makeState(std::pmr::memory_resource *upstream,
+                                              Locking locking) noexcept(false) {
+    auto state = std::make_shared<NetStateT>(upstream);
+    state->track_changes = true;
+    if (locking == Locking::k_places) {
+      state->place_locks = std::make_unique<std::mutex[]>(NetStateT::k_place_lock_stripes);
+    }
+    if (locking == Locking::k_atomic || locking == Locking::k_optimistic) {
+      if (!NetStateT::k_atomic_tokens_supported) {
+        throw std::invalid_argument("Locking::k_atomic and Locking::k_optimistic require "
+                                    "integral tokens");
+      }
+      state->atomic_tokens = true;
+      state->mutex.enableFastPath();
+    }
+    // Place-locked firings only need atomic deficits, tokens of any type are fine
+    state->atomic_tracking =
+        state->atomic_tokens || (locking == Locking::k_places && atomics::k_supported);
+    if (locking == Locking::k_optimistic) {
+      state->place_versions =
+          std::make_unique<std::uint64_t[]>(NetStateT::k_place_lock_stripes);
+    }
+    return state;
+  }
+
   ///
-  ///\throws std::invalid_argument if the ID already exists or any ID of a Place referenced in it
-  /// is non-existent.
+  ///\brief Check if a Transition is ready (does not lock the mutex)
   ///
-  std::shared_ptr<TransitionT> addTransitionAcquired(const TransitionSketch &sketch) noexcept(
-      false) {
-    std::vector<WeightPairT> ingoing;
-    ingoing.reserve(sketch.ingoing.size());
-    std::vector<WeightPairT> outgoing;
-    outgoing.reserve(sketch.outgoing.size());
+  ///\param pos the position of the Transition
+  ///
+  bool readyAcquired(std::size_t pos) const noexcept(true) {
+    return this->state_->loadDeficit(pos) == 0;
+  }
 
-    // Do not allow duplicate IDs
-    if (findTransitionAcquired(sketch.id) != nullptr) {
-      throw std::invalid_argument("TransitionID already exists");
+  ///
+  ///\brief Update the deficits of all consumers of a place in the compiled net (does not lock
+  /// the mutex)
+  ///
+  ///\param compiled the compiled net
+  ///\param place the place position
+  ///\param prev the previous tokens of the place
+  ///
+  void updateConsumersAcquired(const CompiledNetT &compiled, std::size_t place,
+                               const TokenCounterT &prev) const noexcept(true) {
+    const auto &tokens = this->state_->marking[place];
+    auto [begin, end] = compiled.consumers(place);
+    const auto *weight = compiled.consumerWeights(place);
+    for (const auto *t = begin; t != end; ++t, ++weight) {
+      this->state_->tokensChanged(*t, *weight, prev, tokens);
     }
+  }
 
-    // Find all ingoing places
-    for (auto &[pid, weight] : sketch.ingoing) {
-      auto place = findPlaceAcquired(pid);
-      if (place == nullptr) {
-        throw std::invalid_argument("Sketch contains invalid IDs");
+  ///
+  ///\brief Remove the tokens of the ingoing arcs of a Transition if ready (does not lock the
+  /// mutex)
+  ///
+  /// Uses the compiled net if available.
+  ///
+  ///\param pos the position of the Transition
+  ///\param places_to_notify receives all changed places with a listener and their previous
+  /// token count
+  ///\return true consumed
+  ///\return false not ready
+  ///
+  bool consumeAcquired(std::size_t pos, NotifyListT &places_to_notify) const noexcept(false) {
+    if (!this->readyAcquired(pos)) {
+      return false;
+    }
+
+    const auto &compiled = this->state_->compiled;
+    if (compiled == nullptr) {
+      this->state_->transitions[pos]->consumeAcquired(places_to_notify);
+    } else {
+      compiled->consume(this->state_->marking.data(), pos,
+                        this->compiledChangeHandler(*compiled, places_to_notify));
+    }
+    return true;
+  }
+
+  ///
+  ///\brief Add the tokens of the outgoing arcs of a Transition (does not lock the mutex)
+  ///
+  /// Uses the compiled net if available.
+  ///
+  ///\param pos the position of the Transition
+  ///\param places_to_notify receives all changed places with a listener and their previous
+  /// token count
+  ///
+  void produceAcquired(std::size_t pos, NotifyListT &places_to_notify) const noexcept(false) {
+    const auto &compiled = this->state_->compiled;
+    if (compiled == nullptr) {
+      this->state_->transitions[pos]->produceAcquired(places_to_notify);
+    } else {
+      compiled->produce(this->state_->marking.data(), pos,
+                        this->compiledChangeHandler(*compiled, places_to_notify));
+    }
+  }
+
+  ///
+  ///\brief Take all queued transitions out of the dirty queue
+  ///
+  ///\return std::vector<std::size_t> the positions of the queued transitions (ascending, owned
+  /// by the caller, so concurrent and nested calls do not share it)
+  ///
+  std::vector<std::size_t> takeDirty() noexcept(false) {
+    std::vector<std::size_t> ticking;
+    {
+      std::lock_guard lock(this->state_->mutex);
+
+      auto &state = *this->state_;
+      state.syncTracking();
+      // The swapped in queue needs the capacity markDirty() relies on
+      ticking.reserve(state.dirty.capacity());
+      std::swap(state.dirty, ticking);
+      for (auto pos : ticking) {
+        state.dirty_flags[pos] = 0;
+      }
+    }
+
+    std::sort(begin(ticking), end(ticking));
+    return ticking;
+  }
+
+  ///
+  ///\brief Create the on_change handler for token changes of the compiled net
+  ///
+  auto compiledChangeHandler(const CompiledNetT &compiled, NotifyListT &places_to_notify) const
+      noexcept(true) {
+    return [this, &compiled, &places_to_notify](auto place, const auto &prev) {
+      this->updateConsumersAcquired(compiled, place, prev);
+      auto *ptr = this->state_->places[place];
+      if (ptr->observed()) {
+        places_to_notify.push_back(std::make_pair(ptr, prev));
       }
-      ingoing.push_back(std::make_pair(place, weight));
+    };
+  }
+
+  ///
+  ///\brief Fire a Transition if ready (does not lock the mutex)
+  ///
+  /// Uses the compiled net if available.
+  ///
+  ///\param pos the position of the Transition
+  ///\param places_to_notify receives all changed places with a listener and their previous
+  /// token count
+  ///
+  bool fireAcquired(std::size_t pos, NotifyListT &places_to_notify) const noexcept(false) {
+    if (!this->consumeAcquired(pos, places_to_notify)) {
+      return false;
     }
 
-    // Find all outgoing places
-    for (auto &[pid, weight] : sketch.outgoing) {
+    this->produceAcquired(pos, places_to_notify);
+    return true;
+  }
+
+  ///
+  ///\brief tick() a Transition through fire(TransitionIndex)
+  ///
+  ///\return bool fired?
+  ///
+  bool tickTransition(const TransitionT &transition) const noexcept(true) {
+    if (transition.evaluate_condition_ != nullptr && transition.evaluate_condition_(transition)) {
+      return this->fire(transition.getIndex());
+    }
+    return false;
+  }
+
+  ///
+  ///\brief tick() a Transition, firing it up to max_fires times in one go (as far as its tokens
+  /// allow)
+  ///
+  /// The condition is evaluated once. Transitions without weighted ingoing arcs fire max_fires
+  /// times.
+  ///
+  ///\return std::size_t how often the Transition fired
+  ///
+  std::size_t tickTransitionN(const TransitionT &transition, std::size_t max_fires) const
+      noexcept(false) {
+    if (max_fires == 0 || transition.evaluate_condition_ == nullptr ||
+        !transition.evaluate_condition_(transition)) {
+      return 0;
+    }
+
+    NotifyListT places_to_notify;
+    std::size_t n = 0;
+    {
+      std::lock_guard lock(this->state_->mutex);
+      n = std::min<std::size_t>(max_fires, std::numeric_limits<TokenCounterT>::max());
+      auto degree = transition.enablingDegreeAcquired();
+      if (degree.has_value() && static_cast<std::size_t>(*degree) < n) {
+        n = static_cast<std::size_t>(*degree);
+      }
+      if (n != 0) {
+        transition.fireNAcquired(static_cast<TokenCounterT>(n), places_to_notify);
+      }
+    }
+
+    TransitionT::notify(places_to_notify);
+
+    return n;
+  }
+
+  ///
+  ///\brief deepTickCover() of an acyclic compiled net in one sweep over the topological order
+  ///
+  /// deepTickCover() ticks the consumers of a place once for the place itself and once more for
+  /// every firing into it. The sweep counts these ticks per place instead of walking the paths,
+  /// and fires each Transition as often as it is ticked at once (tickTransitionN()), after all
+  /// Transitions it may receive tokens from.
+  ///
+  ///\param compiled the compiled net (acyclic)
+  ///
+  void sweepTopologically(const CompiledNetT &compiled) const noexcept(false) {
+    auto saturating_add = [](std::size_t a, std::size_t b) {
+      return a > std::numeric_limits<std::size_t>::max() - b
+                 ? std::numeric_limits<std::size_t>::max()
+                 : a + b;
+    };
+
+    std::vector<std::size_t> ticks(compiled.placeCount(), 1);
+    const auto &pre = compiled.pre();
+    const auto &post = compiled.post();
+    for (auto pos : compiled.topologicalOrder()) {
+      std::size_t count = 0;
+      for (auto k = pre.offsets[pos]; k < pre.offsets[pos + 1]; ++k) {
+        count = saturating_add(count, ticks[pre.places[k]]);
+      }
+
+      auto fired = this->tickTransitionN(this->transitionShared(pos), count);
+      for (auto k = post.offsets[pos]; k < post.offsets[pos + 1] && fired != 0; ++k) {
+        ticks[post.places[k]] = saturating_add(ticks[post.places[k]], fired);
+      }
+    }
+  }
+
+  ///
+  ///\brief Get the Transition at a position under the shared lock (Transitions do not move, the
+  /// reference stays valid while the net lives)
+  ///
+  ///\param pos the position of the Transition
+  ///
+  TransitionT &transitionShared(std::size_t pos) const noexcept(true) {
+    std::shared_lock lock(this->state_->mutex);
+    return *this->state_->transitions[pos];
+  }
+
+  ///
+  ///\brief Tick the consumers of the outgoing places of a fired Transition and of everything
+  /// they fire, one task per place on all threads of a pool (the net must be acyclic)
+  ///
+  ///\param compiled the compiled net
+  ///\param fired the position of the fired Transition
+  ///\param pool the threads to use
+  ///
+  void propagateParallel(const CompiledNetT &compiled, std::size_t fired,
+                         ThreadPool &pool) const noexcept(false) {
+    const auto &post = compiled.post();
+    std::vector<std::size_t> places(post.places.begin() + post.offsets[fired],
+                                    post.places.begin() + post.offsets[fired + 1]);
+    pool.runTasks(places, [&](std::size_t place, auto &spawn) {
+      auto [begin, end] = compiled.consumers(place);
+      for (const auto *t = begin; t != end; ++t) {
+        // Not holding the lock while ticking, firing may take it exclusively
+        if (this->tickTransition(this->transitionShared(*t))) {
+          for (auto k = post.offsets[*t]; k < post.offsets[*t + 1]; ++k) {
+            spawn(post.places[k]);
+          }
+        }
+      }
+    });
+  }
+
+  ///
+  ///\brief The adjacency of the compiled net, for NetState::deepTick()
+  ///
+  struct CompiledGraph {
+    const PetriNet *net;
+    const CompiledNetT *compiled;
+
+    std::size_t placeCount() const noexcept(true) { return this->compiled->placeCount(); }
+
+    std::size_t consumerCount(std::size_t place) const noexcept(true) {
+      auto [begin, end] = this->compiled->consumers(place);
+      return static_cast<std::size_t>(end - begin);
+    }
+
+    std::size_t consumer(std::size_t place, std::size_t i) const noexcept(true) {
+      return this->compiled->consumers(place).first[i];
+    }
+
+    std::size_t outputCount(std::size_t transition) const noexcept(true) {
+      const auto &post = this->compiled->post();
+      return post.offsets[transition + 1] - post.offsets[transition];
+    }
+
+    std::size_t output(std::size_t transition, std::size_t i) const noexcept(true) {
+      const auto &post = this->compiled->post();
+      return post.places[post.offsets[transition] + i];
+    }
+
+    bool tick(std::size_t transition) const noexcept(true) {
+      return this->net->tickTransition(this->net->transitionShared(transition));
+    }
+  };
+
+  ///
+  ///\brief Resolve the place IDs of sketch arcs (do not lock the mutex)
+  ///
+  ///\param arcs the <placeId, weight> pairs of a sketch
+  ///\param resolved receives the <Place, weight> pairs
+  ///\throws std::invalid_argument if a Place ID is non-existent
+  ///
+  template <typename SketchArcs>
+  void resolveAcquired(const SketchArcs &arcs, std::vector<WeightPairT> &resolved) const
+      noexcept(false) {
+    for (const auto &[pid, weight] : arcs) {
       auto place = findPlaceAcquired(pid);
       if (place == nullptr) {
         throw std::invalid_argument("Sketch contains invalid IDs");
       }
-      outgoing.push_back(std::make_pair(place, weight));
+      resolved.push_back(std::make_pair(place, weight));
     }
+  }
 
-    // add new transition
-    auto ptr = std::shared_ptr<TransitionT>(
-        new TransitionT(sketch.id, std::move(ingoing), std::move(outgoing), mutex_));
-    transitions_.push_back(ptr);
+  ///
+  ///\brief Create a new Transition from the resolved scratch arcs (do not lock the mutex)
+  ///
+  ///\param id the Transition's ID (must not exist yet)
+  ///\return TransitionIndex the handle of the new Transition
+  ///
+  TransitionIndex emplaceTransitionAcquired(IDT &&id) noexcept(false) {
+    auto &transitions = this->state_->transitions;
+    auto index = TransitionIndex(transitions.size());
+    this->state_->compiled.reset();
+    transitions.push_back(nullptr);
+    try {
+      auto *ptr = new (this->state_->template allocate<TransitionT>())
+          TransitionT(std::move(id), index, this->ingoing_scratch_, this->outgoing_scratch_,
+                      this->state_.get());
+      transitions.back() = ptr;
+      this->transition_index_.insert(ptr->getID(), transitions.size() - 1);
+
+      // add to neighbour mappings
+      for (auto &arc : ptr->ingoing_) {
+        arc.place->ingoing_to_.push_back({ptr, arc.weight});
+      }
+      for (auto &arc : ptr->outgoing_) {
+        arc.place->outgoing_to_.push_back(ptr);
+      }
 
-    // add to neighbour mappings
-    for (auto &[place, _] : ptr->ingoing_) {
-      place->ingoing_to_.push_back(ptr);
+      this->state_->pushDeficit(ptr->countDeficitAcquired());
+    } catch (...) {
+      this->rollbackAcquired(this->state_->places.size(), transitions.size() - 1);
+      throw;
     }
-    for (auto &[place, _] : ptr->outgoing_) {
-      place->outgoing_to_.push_back(ptr);
+    return index;
+  }
+
+  ///
+  ///\brief Add a new Transition (do not lock the mutex)
+  ///
+  ///\param sketch the transition blueprint (its ID is moved if it is an rvalue)
+  ///\return TransitionIndex the handle of the new Transition
+  ///
+  ///\throws std::invalid_argument if the ID already exists or any ID of a Place referenced in it
+  /// is non-existent.
+  ///
+  template <typename Sketch>
+  TransitionIndex addTransitionAcquired(Sketch &&sketch) noexcept(false) {
+    // Do not allow duplicate IDs
+    if (findTransitionAcquired(sketch.id) != nullptr) {
+      throw std::invalid_argument("TransitionID already exists");
     }
 
-    return ptr;
+    this->ingoing_scratch_.clear();
+    this->outgoing_scratch_.clear();
+    this->resolveAcquired(sketch.ingoing, this->ingoing_scratch_);
+    this->resolveAcquired(sketch.outgoing, this->outgoing_scratch_);
+
+    return this->emplaceTransitionAcquired(IDT(std::forward<Sketch>(sketch).id));
   }
 
 public:
   ///
   ///\brief Construct a new PetriNet
   ///
-  PetriNet() : mutex_(std::make_shared<std::shared_mutex>()) {}
+  /// Places, Transitions and their arcs are allocated from an arena which requests its memory
+  /// from std::pmr::get_default_resource() and is released when the net is destroyed.
+  ///
+  PetriNet() : state_(makeState(std::pmr::get_default_resource(), Locking::k_net)) {}
+
+  ///
+  ///\brief Construct a new PetriNet with a custom memory resource
+  ///
+  ///\param upstream the resource the arena of the nodes requests its memory from (must outlive
+  /// the net and all pointers to its nodes)
+  ///
+  explicit PetriNet(std::pmr::memory_resource *upstream)
+      : state_(makeState(upstream, Locking::k_net)) {}
+
+  ///
+  ///\brief Construct a new PetriNet with a synchronization mode
+  ///
+  ///\param locking how firing is synchronized
+  ///\param upstream the resource the arena of the nodes requests its memory from (must outlive
+  /// the net and all pointers to its nodes)
+  ///\throws std::invalid_argument if Locking::k_atomic or Locking::k_optimistic is used with
+  /// non-integral tokens
+  ///
+  explicit PetriNet(Locking locking,
+                    std::pmr::memory_resource *upstream = std::pmr::get_default_resource())
+      : state_(makeState(upstream, locking)) {}
+
+  ///
+  ///\brief Get how firing is synchronized
+  ///
+  [[nodiscard]] Locking locking() const noexcept(true) {
+    if (this->state_->validatesVersions()) {
+      return Locking::k_optimistic;
+    }
+    if (this->state_->atomic_tokens) {
+      return Locking::k_atomic;
+    }
+    return this->state_->locksPlaces() ? Locking::k_places : Locking::k_net;
+  }
 
   ///
   ///\brief find a Place with the given ID
   ///
+  /// Accepts IDT or any type usable for lookups without creating an IDT (e.g. std::string_view).
+  ///
   ///\param id  the ID
   ///\return std::shared_ptr<PlaceT> may be nullptr if the ID was not found
   ///
-  [[nodiscard]] std::shared_ptr<PlaceT> findPlace(const IDT &id) noexcept(true) {
-    std::shared_lock lock(*this->mutex_);
+  template <typename K = IDT, typename = EnableIfLookupKeyT<K>>
+  [[nodiscard]] std::shared_ptr<PlaceT> findPlace(const K &id) noexcept(true) {
+    std::shared_lock lock(this->state_->mutex);
 
-    return this->findPlaceAcquired(id);
+    return this->share(this->findPlaceAcquired(id));
   }
 
   ///
   ///\brief find a Transition with the given ID
   ///
+  /// Accepts IDT or any type usable for lookups without creating an IDT (e.g. std::string_view).
+  ///
   ///\param id the ID
   ///\return std::shared_ptr<TransitionT> may be nullptr if the ID was not found
   ///
-  [[nodiscard]] std::shared_ptr<TransitionT> findTransition(const IDT &id) noexcept(true) {
-    std::shared_lock lock(*this->mutex_);
+  template <typename K = IDT, typename = EnableIfLookupKeyT<K>>
+  [[nodiscard]] std::shared_ptr<TransitionT> findTransition(const K &id) noexcept(true) {
+    std::shared_lock lock(this->state_->mutex);
 
-    return this->findTransitionAcquired(id);
+    return this->share(this->findTransitionAcquired(id));
   }
 
   PetriNet<IDT, TokenCounterT> &&clone() const;
@@ -211,69 +708,428 @@ public:
   ///\param id the Place's ID
   ///\param initial_tokens the number of initial tokens on this Place
   ///
+  ///\return PlaceIndex the handle of the new Place
   ///\throws std::invalid_argument if the ID already exists
   ///
-  std::shared_ptr<PlaceT> addPlace(const IDT &id, TokenCounterT initial_tokens) noexcept(false) {
-    std::lock_guard lock(*this->mutex_);
+  PlaceIndex addPlace(IDT id, TokenCounterT initial_tokens) noexcept(false) {
+    std::lock_guard lock(this->state_->mutex);
 
-    return this->addPlaceAcquired(id, initial_tokens);
+    return this->addPlaceAcquired(std::move(id), initial_tokens);
+  }
+
+  ///
+  ///\brief Add multiple Places at once (all or nothing)
+  ///
+  /// Takes the lock once and reserves all storage up front. The IDs are moved if places is an
+  /// rvalue.
+  ///
+  ///\param places a range of <id, initial_tokens> pairs
+  ///\return PlaceIndex the handle of the first new Place, the others follow consecutively
+  ///\throws std::invalid_argument if any ID already exists or is contained twice (no Place is
+  /// added)
+  ///
+  template <typename Range> PlaceIndex addPlaces(Range &&places) noexcept(false) {
+    std::lock_guard lock(this->state_->mutex);
+
+    auto &state = *this->state_;
+    auto first = state.places.size();
+
+    // Validate all IDs before changing anything
+    IdIndexT batch;
+    for (auto &[id, _] : places) {
+      static_assert(std::is_same_v<std::decay_t<decltype(id)>, IDT>, "Places need IDT IDs");
+      if (this->place_index_.contains(id) || !batch.insert(id, 0)) {
+        throw std::invalid_argument("PlaceID already exists");
+      }
+    }
+
+    try {
+      state.places.reserve(first + batch.size());
+      state.marking.reserve(first + batch.size());
+      this->place_index_.reserve(first + batch.size());
+      for (auto &[id, initial_tokens] : places) {
+        if constexpr (std::is_lvalue_reference_v<Range>) {
+          this->emplacePlaceAcquired(IDT(id), initial_tokens);
+        } else {
+          this->emplacePlaceAcquired(IDT(std::move(id)), initial_tokens);
+        }
+      }
+    } catch (...) {
+      this->rollbackAcquired(first, state.transitions.size());
+      throw;
+    }
+
+    return PlaceIndex(first);
   }
 
   ///
   ///\brief Add a new Transition
   ///
+  /// The sketch may reference places by any type usable for lookups (e.g. std::string_view).
+  ///
   ///\param sketch the transition blueprint
+  ///\return TransitionIndex the handle of the new Transition
   ///
   ///\throws std::invalid_argument if the ID already exists or any ID of a Place referenced in it
   /// is non-existent.
   ///
-  std::shared_ptr<TransitionT> addTransition(const TransitionSketch &sketch) noexcept(false) {
-    std::lock_guard lock(*this->mutex_);
+  template <typename K = IDT, typename = EnableIfLookupKeyT<K>>
+  TransitionIndex addTransition(const BasicTransitionSketch<K> &sketch) noexcept(false) {
+    std::lock_guard lock(this->state_->mutex);
 
     return this->addTransitionAcquired(sketch);
   }
 
+  ///
+  ///\brief Add a new Transition (moves the ID out of the sketch)
+  ///
+  ///\param sketch the transition blueprint
+  ///\return TransitionIndex the handle of the new Transition
+  ///
+  ///\throws std::invalid_argument if the ID already exists or any ID of a Place referenced in it
+  /// is non-existent.
+  ///
+  template <typename K = IDT, typename = EnableIfLookupKeyT<K>>
+  TransitionIndex addTransition(BasicTransitionSketch<K> &&sketch) noexcept(false) {
+    std::lock_guard lock(this->state_->mutex);
+
+    return this->addTransitionAcquired(std::move(sketch));
+  }
+
+  ///
+  ///\brief Add multiple Transitions at once (all or nothing)
+  ///
+  /// Takes the lock once, resolves all sketches in one pass and reserves all storage up front.
+  /// The IDs are moved if sketches is an rvalue.
+  ///
+  ///\param sketches a range of BasicTransitionSketch
+  ///\return TransitionIndex the handle of the first new Transition, the others follow
+  /// consecutively
+  ///\throws std::invalid_argument if any ID already exists, is contained twice or any ID of a
+  /// referenced Place is non-existent (no Transition is added)
+  ///
+  template <typename Range> TransitionIndex addTransitions(Range &&sketches) noexcept(false) {
+    std::lock_guard lock(this->state_->mutex);
+
+    auto &state = *this->state_;
+    auto first = state.transitions.size();
+
+    // Validate all sketches and resolve their places before changing anything
+    IdIndexT batch;
+    std::vector<WeightPairT> arcs;
+    std::vector<std::size_t> ends;
+    for (auto &sketch : sketches) {
+      if (this->transition_index_.contains(sketch.id) || !batch.insert(sketch.id, 0)) {
+        throw std::invalid_argument("TransitionID already exists");
+      }
+      this->resolveAcquired(sketch.ingoing, arcs);
+      ends.push_back(arcs.size());
+      this->resolveAcquired(sketch.outgoing, arcs);
+      ends.push_back(arcs.size());
+    }
+
+    try {
+      state.transitions.reserve(first + batch.size());
+      this->transition_index_.reserve(first + batch.size());
+      std::size_t begin = 0;
+      auto end = cbegin(ends);
+      for (auto &sketch : sketches) {
+        this->ingoing_scratch_.assign(cbegin(arcs) + begin, cbegin(arcs) + *end);
+        begin = *end++;
+        this->outgoing_scratch_.assign(cbegin(arcs) + begin, cbegin(arcs) + *end);
+        begin = *end++;
+        if constexpr (std::is_lvalue_reference_v<Range>) {
+          this->emplaceTransitionAcquired(IDT(sketch.id));
+        } else {
+          this->emplaceTransitionAcquired(IDT(std::move(sketch.id)));
+        }
+      }
+    } catch (...) {
+      this->rollbackAcquired(state.places.size(), first);
+      throw;
+    }
+
+    return TransitionIndex(first);
+  }
+
+  ///
+  ///\brief Access a Place by its handle
+  ///
+  /// NOTE: the handle must have been returned by this net (handles of merged nets are invalid)
+  ///
+  ///\param index the handle
+  ///\return PlaceT& the Place
+  ///
+  [[nodiscard]] PlaceT &place(PlaceIndex index) const noexcept(true) {
+    std::shared_lock lock(this->state_->mutex);
+
+    return *this->state_->places[static_cast<std::size_t>(index)];
+  }
+
+  ///
+  ///\brief Access a Transition by its handle
+  ///
+  /// NOTE: the handle must have been returned by this net (handles of merged nets are invalid)
+  ///
+  ///\param index the handle
+  ///\return TransitionT& the Transition
+  ///
+  [[nodiscard]] TransitionT &transition(TransitionIndex index) const noexcept(true) {
+    std::shared_lock lock(this->state_->mutex);
+
+    return *this->state_->transitions[static_cast<std::size_t>(index)];
+  }
+
+  ///
+  ///\brief Get the current amount of Tokens on a Place
+  ///
+  ///\param index the Place's handle
+  ///\return TokenCounterT the amount
+  ///
+  [[nodiscard]] TokenCounterT tokens(PlaceIndex index) const noexcept(true) {
+    std::shared_lock lock(this->state_->mutex);
+    auto place_lock = this->state_->lockPlace(static_cast<std::size_t>(index));
+
+    return this->state_->loadTokens(static_cast<std::size_t>(index));
+  }
+
+  ///
+  ///\brief Get a snapshot of the tokens of all Places
+  ///
+  ///\return std::vector<TokenCounterT> the tokens, indexed by PlaceIndex
+  ///
+  [[nodiscard]] std::vector<TokenCounterT> marking() const noexcept(false) {
+    if (this->state_->atomic_tokens || this->state_->locksPlaces()) {
+      // Firings of these modes only hold the shared lock, wait for the running ones for a
+      // consistent snapshot
+      std::lock_guard lock(this->state_->mutex);
+      return this->state_->marking;
+    }
+
+    std::shared_lock lock(this->state_->mutex);
+    return this->state_->marking;
+  }
+
+  ///
+  ///\brief Check if a Transition is ready to fire()
+  ///
+  ///\param index the Transition's handle
+  ///\return true ready
+  ///\return false not ready
+  ///
+  [[nodiscard]] bool ready(TransitionIndex index) const noexcept(true) {
+    std::shared_lock lock(this->state_->mutex);
+    auto tracking_lock = this->state_->lockTracking();
+
+    return this->readyAcquired(static_cast<std::size_t>(index));
+  }
+
+  ///
+  ///\brief Get all enabled Transitions
+  ///
+  /// The enabled Transitions are tracked while tokens change, so this does not check every
+  /// Transition of the net.
+  ///
+  ///\return std::vector<TransitionIndex> the enabled Transitions in ascending order
+  ///
+  [[nodiscard]] std::vector<TransitionIndex> enabled() const noexcept(false) {
+    std::vector<TransitionIndex> result;
+    {
+      std::shared_lock lock(this->state_->mutex);
+      auto tracking_lock = this->state_->lockTracking();
+
+      result.reserve(this->state_->enabled.size());
+      this->state_->forEachEnabled([&](std::size_t pos) { result.push_back(TransitionIndex(pos)); });
+    }
+    std::sort(begin(result), end(result));
+    return result;
+  }
+
+  ///
+  ///\brief Get all enabled Transitions as a bitset
+  ///
+  /// Takes the lock once and only visits the tracked enabled Transitions (plus one word per 64
+  /// Transitions of the net).
+  ///
+  ///\return TransitionSet the enabled Transitions
+  ///
+  [[nodiscard]] TransitionSet enabledTransitions() const noexcept(false) {
+    std::shared_lock lock(this->state_->mutex);
+    auto tracking_lock = this->state_->lockTracking();
+
+    TransitionSet set(this->state_->transitions.size());
+    this->state_->forEachEnabled([&](std::size_t pos) { set.insert(TransitionIndex(pos)); });
+    return set;
+  }
+
+  ///
+  ///\brief Try to fire() a Transition
+  ///
+  ///\param index the Transition's handle
+  ///\return true successfull
+  ///\return false not ready
+  ///
+  bool fire(TransitionIndex index) const noexcept(true) {
+    NotifyListT places_to_notify;
+
+    bool rdy;
+    if (this->state_->validatesVersions()) {
+      FastReadLock lock(this->state_->mutex);
+      rdy = this->state_->transitions[static_cast<std::size_t>(index)]->fireOptimisticAcquired(
+          places_to_notify);
+    } else if (this->state_->atomic_tokens) {
+      FastReadLock lock(this->state_->mutex);
+      rdy = this->state_->transitions[static_cast<std::size_t>(index)]->fireAtomicAcquired(
+          places_to_notify);
+    } else if (this->state_->locksPlaces()) {
+      std::shared_lock lock(this->state_->mutex);
+      const auto *transition = this->state_->transitions[static_cast<std::size_t>(index)];
+      if (transition->locksPlaces()) {
+        rdy = transition->fireLockingPlacesAcquired(places_to_notify);
+      } else {
+        lock.unlock();
+        std::lock_guard exclusive_lock(this->state_->mutex);
+        rdy = this->fireAcquired(static_cast<std::size_t>(index), places_to_notify);
+      }
+    } else {
+      this->state_->mutex.lock();
+      rdy = this->fireAcquired(static_cast<std::size_t>(index), places_to_notify);
+      this->state_->mutex.unlock();
+    }
+
+    TransitionT::notify(places_to_notify);
+
+    return rdy;
+  }
+
+  ///
+  ///\brief Fire multiple Transitions as one step under a single lock acquisition
+  ///
+  /// All ingoing tokens of the step are removed before any outgoing tokens are added, so
+  /// tokens produced by the step can not enable other Transitions of the same step. A
+  /// Transition may be contained multiple times. Transitions which are not ready or in conflict
+  /// with earlier Transitions of the step (not enough tokens left) are skipped.
+  ///
+  ///\param step the handles of the Transitions to fire
+  ///\return std::vector<TransitionIndex> the fired Transitions (in the order of step)
+  ///
+  std::vector<TransitionIndex> fireStep(const std::vector<TransitionIndex> &step) const
+      noexcept(false) {
+    std::vector<TransitionIndex> fired;
+    fired.reserve(step.size());
+    NotifyListT places_to_notify;
+    {
+      std::lock_guard lock(this->state_->mutex);
+
+      for (auto index : step) {
+        if (this->consumeAcquired(static_cast<std::size_t>(index), places_to_notify)) {
+          fired.push_back(index);
+        }
+      }
+      for (auto index : fired) {
+        this->produceAcquired(static_cast<std::size_t>(index), places_to_notify);
+      }
+    }
+
+    TransitionT::notify(places_to_notify);
+
+    return fired;
+  }
+
+  ///
+  ///\brief Fire a maximal step of the enabled Transitions under a single lock acquisition
+  ///
+  /// The enabled Transitions fire in rounds in ascending order, one firing per Transition and
+  /// round, until no Transition can fire without tokens produced by the step (same step
+  /// semantics as fireStep()). Transitions without ingoing arcs (or only arcs without weight)
+  /// fire once.
+  ///
+  ///\return std::vector<TransitionIndex> the fired Transitions (in firing order)
+  ///
+  std::vector<TransitionIndex> fireMaximalStep() const noexcept(false) {
+    std::vector<TransitionIndex> fired;
+    NotifyListT places_to_notify;
+    {
+      std::lock_guard lock(this->state_->mutex);
+
+      auto &state = *this->state_;
+      state.syncTracking();
+      std::vector<std::size_t> candidates(cbegin(state.enabled), cend(state.enabled));
+      std::sort(begin(candidates), end(candidates));
+      while (!candidates.empty()) {
+        // Keep the candidates which may fire again in the next round
+        std::size_t kept = 0;
+        for (auto pos : candidates) {
+          if (this->consumeAcquired(pos, places_to_notify)) {
+            fired.push_back(TransitionIndex(pos));
+            // Unbounded (no weighted ingoing arc) fires once like a source
+            if (state.transitions[pos]->enablingDegreeAcquired().has_value()) {
+              candidates[kept++] = pos;
+            }
+          }
+        }
+        candidates.resize(kept);
+      }
+      for (auto index : fired) {
+        this->produceAcquired(static_cast<std::size_t>(index), places_to_notify);
+      }
+    }
+
+    TransitionT::notify(places_to_notify);
+
+    return fired;
+  }
+
+  ///
+  ///\brief Re-evaluate the autoFire() condition of a Transition on the next tickDirty()
+  ///
+  ///\param index the Transition's handle
+  ///
+  void invalidate(TransitionIndex index) noexcept(true) {
+    std::lock_guard lock(this->state_->mutex);
+
+    this->state_->transitions[static_cast<std::size_t>(index)]->invalidateAcquired();
+  }
+
   ///
   ///\brief Merge another PetriNet into this one.
   ///
   /// The interconnections are used to connect the two nets, each interconnection
   /// shall contain a Place from this and a place from other.
   /// NOTE: The other PetriNet will be empty afterwards to ensure no two Nodes/Transitions have
-  /// the same callback functions registered
+  /// the same callback functions registered. Its nodes are recreated inside this net, pointers
+  /// obtained from other before the merge stay valid but are detached from both nets.
   ///
   ///\param other the PetriNet to merge into this
   ///\param interconnections all interconnections between our places and other places
   ///
   void merge(PetriNet &&other,
              const std::vector<TransitionSketch> &interconnections) noexcept(false) {
-    // Keep both nets locked
-    std::lock_guard l1(*other.mutex_);
-    std::lock_guard l2(*this->mutex_);
+    // Keep both nets locked (and the nodes of other alive until they are recreated)
+    auto other_state = other.state_;
+    std::lock_guard l1(other_state->mutex);
+    std::lock_guard l2(this->state_->mutex);
+
+    this->state_->compiled.reset();
+    other_state->compiled.reset();
 
     // Check for duplicate PlaceIDs
-    for (const auto &place : other.places_) {
-      auto it = std::find_if(cbegin(this->places_), cend(this->places_),
-                             [&](const auto &p) { return p->getID() == place->getID(); });
-      if (it != cend(this->places_)) {
+    for (const auto &place : other_state->places) {
+      if (this->place_index_.contains(place->getID())) {
         throw std::invalid_argument("Duplicate PlaceIDs");
       }
     }
 
     // Check for duplicate TransitionIDs in other
-    for (const auto &transition : other.transitions_) {
-      auto it = std::find_if(cbegin(this->transitions_), cend(this->transitions_),
-                             [&](const auto &t) { return t->getID() == transition->getID(); });
-      if (it != cend(this->transitions_)) {
+    for (const auto &transition : other_state->transitions) {
+      if (this->transition_index_.contains(transition->getID())) {
         throw std::invalid_argument("Duplicate TransactionIDs");
       }
     }
 
     // Check for duplicate TransitionIDs in interconnections
     for (const auto &[tid, _, __] : interconnections) {
-      const auto &tid_r = tid;  // lambda captures seem to dislike structural decomposition vars :(
-      auto it = std::find_if(cbegin(this->transitions_), cend(this->transitions_),
-                             [&](const auto &t) { return t->getID() == tid_r; });
-      if (it != cend(this->transitions_)) {
+      if (this->transition_index_.contains(tid)) {
         throw std::invalid_argument("Duplicate TransitionIDs");
       }
     }
@@ -281,38 +1137,49 @@ public:
     using SketchEvalCondPair =
         std::pair<TransitionSketch, std::function<bool(const TransitionT &)>>;
     std::vector<SketchEvalCondPair> new_transitions;
-    new_transitions.reserve(other.transitions_.size());
+    new_transitions.reserve(other_state->transitions.size());
+    std::vector<int> priorities;
+    priorities.reserve(other_state->transitions.size());
 
     // Create sketches for each other transition
-    for (const auto &t : other.transitions_) {
+    for (const auto &t : other_state->transitions) {
       TransitionSketch sketch;
       sketch.id = t->getID();
 
-      auto to_sketch_weight_pair = [&](const auto &wp) ->
+      auto to_sketch_weight_pair = [&](const auto &arc) ->
           typename TransitionSketch::SketchWeightPairT {
-            return {wp.first->getID(), wp.second};
+            return {arc.place->getID(), arc.weight};
           };
-      std::transform(cbegin(t->ingoing_), cend(t->ingoing_), std::back_inserter(sketch.ingoing),
-                     to_sketch_weight_pair);
-      std::transform(cbegin(t->outgoing_), cend(t->outgoing_), std::back_inserter(sketch.outgoing),
+      std::transform(t->ingoing_.cbegin(), t->ingoing_.cend(), std::back_inserter(sketch.ingoing),
                      to_sketch_weight_pair);
+      std::transform(t->outgoing_.cbegin(), t->outgoing_.cend(),
+                     std::back_inserter(sketch.outgoing), to_sketch_weight_pair);
 
-      new_transitions.push_back({std::move(sketch), t->evaluate_condition_});
+      new_transitions.push_back({std::move(sketch), std::move(t->evaluate_condition_)});
+      priorities.push_back(t->priority_);
     }
 
-    other.transitions_.clear();
-
-    // Move other places
-    for (auto &place : other.places_) {
-      place->ingoing_to_.clear();
-      place->outgoing_to_.clear();
+    // Recreate other places (and their tokens) in our arena
+    this->place_index_.reserve(this->state_->places.size() + other_state->places.size());
+    this->state_->marking.reserve(this->state_->places.size() + other_state->places.size());
+    for (auto *place : other_state->places) {
+      auto index = this->addPlaceAcquired(place->getID(), place->tokensAcquired());
+      this->state_->places[static_cast<std::size_t>(index)]->on_change_ =
+          std::move(place->on_change_);
     }
-    std::move(begin(other.places_), end(other.places_), std::back_inserter(this->places_));
+
+    // Leave other empty, its old state is released with the last pointer into it
+    other.state_ = makeState(other_state->upstream, other.locking());
+    other.transition_index_.clear();
+    other.place_index_.clear();
 
     // Create other transitions (will have valid data)
+    auto priority = cbegin(priorities);
     for (const auto &[sketch, eval_cond] : new_transitions) {
-      this->addTransitionAcquired(sketch);
-      this->findTransitionAcquired(sketch.id)->evaluate_condition_ = eval_cond;
+      auto index = this->addTransitionAcquired(sketch);
+      auto *transition = this->state_->transitions[static_cast<std::size_t>(index)];
+      transition->evaluate_condition_ = eval_cond;
+      transition->priority_ = *priority++;
     }
 
     // Create interconnections
@@ -321,13 +1188,259 @@ public:
     }
   }
 
+  ///
+  ///\brief Compile the net into a flat incidence representation
+  ///
+  /// fire(TransitionIndex), ready(TransitionIndex), tick(), deepTick() and deepTickCover() run
+  /// over the compiled net until the structure changes (adding nodes or merging discards it).
+  /// Also sorts the Transitions topologically, so cycles are known before running the net.
+  ///
+  ///\return true the net is acyclic (\see isAcyclic())
+  ///\return false the net has a cycle
+  ///\throws std::length_error if the net has more than 2^32 places or arcs
+  ///
+  bool compile() noexcept(false) {
+    std::lock_guard lock(this->state_->mutex);
+
+    typename CompiledNetT::Incidence pre;
+    typename CompiledNetT::Incidence post;
+    pre.offsets.reserve(this->state_->transitions.size() + 1);
+    post.offsets.reserve(this->state_->transitions.size() + 1);
+    for (const auto &transition : this->state_->transitions) {
+      for (const auto &arc : transition->ingoing_) {
+        pre.append(arc.marking_pos, arc.weight);
+      }
+      pre.endRow();
+      for (const auto &arc : transition->outgoing_) {
+        post.append(arc.marking_pos, arc.weight);
+      }
+      post.endRow();
+    }
+
+    auto compiled = std::make_shared<const CompiledNetT>(this->state_->places.size(),
+                                                         std::move(pre), std::move(post));
+    this->state_->compiled = compiled;
+    return compiled->acyclic();
+  }
+
+  ///
+  ///\brief Get the compiled net (nullptr if not compiled)
+  ///
+  [[nodiscard]] std::shared_ptr<const CompiledNetT> compiledNet() const noexcept(true) {
+    std::shared_lock lock(this->state_->mutex);
+
+    return this->state_->compiled;
+  }
+
+  ///
+  ///\brief Check if the net is compiled (and the compiled net is up to date)
+  ///
+  [[nodiscard]] bool isCompiled() const noexcept(true) {
+    std::shared_lock lock(this->state_->mutex);
+
+    return this->state_->compiled != nullptr;
+  }
+
+  ///
+  ///\brief Check if the compiled net is acyclic (a requirement of tickTopological())
+  ///
+  ///\throws std::logic_error if the net is not compiled
+  ///
+  [[nodiscard]] bool isAcyclic() const noexcept(false) {
+    auto compiled = this->compiledNet();
+    if (compiled == nullptr) {
+      throw std::logic_error("Net not compiled");
+    }
+    return compiled->acyclic();
+  }
+
   ///
   ///\brief execute tick() of every transition once
   ///
   void tick() noexcept(true) {
-    for (auto &transition : transitions_) {
-      transition->tick();
+    for (auto &transition : this->state_->transitions) {
+      this->tickTransition(*transition);
+    }
+  }
+
+  ///
+  ///\brief execute tick() of every transition once, using all threads of a pool
+  ///
+  /// The Transitions tick color by color of the compiled conflict graph (\see
+  /// CompiledNet::colorClass()), the Transitions of one color concurrently. They do not share
+  /// Places they consume from, so the result equals tick() in the order of the colors, as long
+  /// as the conditions only depend on the Places of their Transition. Conditions have to be
+  /// thread-safe.
+  /// Firings run in parallel with Locking::k_places, Locking::k_atomic and
+  /// Locking::k_optimistic, with Locking::k_net only the conditions are evaluated in parallel.
+  /// Without a compiled net, this is tick().
+  ///
+  ///\param pool the threads to use
+  ///
+  void parallelTick(ThreadPool &pool) noexcept(false) {
+    auto compiled = this->compiledNet();
+    if (compiled == nullptr) {
+      this->tick();
+      return;
+    }
+
+    for (std::size_t color = 0; color < compiled->colorCount(); ++color) {
+      auto [begin, end] = compiled->colorClass(color);
+      pool.parallelFor(static_cast<std::size_t>(end - begin), [&, begin = begin](std::size_t i) {
+        this->tickTransition(this->transitionShared(begin[i]));
+      });
+    }
+  }
+
+  ///
+  ///\brief Tick a Transition, then propagate to all transitions that might have become ready
+  /// on all threads of a pool
+  ///
+  /// Like Transition::deepTick(), but the outgoing places of fired Transitions are queued as
+  /// tasks of ThreadPool::runTasks(), so the lines downstream of a fork tick in parallel. Only
+  /// the order of the ticks differs from Transition::deepTick(), so Transitions competing for
+  /// tokens downstream may resolve their conflicts differently. Conditions have to be
+  /// thread-safe. Without a compiled net, this is Transition::deepTick().
+  ///
+  ///\param index the Transition's handle
+  ///\param pool the threads to use
+  ///\throws std::runtime_error if the compiled net has a cycle (checked before ticking)
+  ///
+  void parallelDeepTick(TransitionIndex index, ThreadPool &pool) noexcept(false) {
+    auto pos = static_cast<std::size_t>(index);
+    auto compiled = this->compiledNet();
+    if (compiled == nullptr) {
+      this->transitionShared(pos).deepTick();
+      return;
+    }
+    if (!compiled->acyclic()) {
+      throw std::runtime_error("Cycle detected");
+    }
+
+    if (this->tickTransition(this->transitionShared(pos))) {
+      this->propagateParallel(*compiled, pos, pool);
+    }
+  }
+
+  ///
+  ///\brief Fire a Transition, then propagate to all transitions that might have become ready
+  /// on all threads of a pool, \see parallelDeepTick()
+  ///
+  ///\param index the Transition's handle
+  ///\param pool the threads to use
+  ///\return true fired
+  ///\return false not ready
+  ///\throws std::runtime_error if the compiled net has a cycle (checked before firing)
+  ///
+  bool parallelDeepFire(TransitionIndex index, ThreadPool &pool) noexcept(false) {
+    auto pos = static_cast<std::size_t>(index);
+    auto compiled = this->compiledNet();
+    if (compiled == nullptr) {
+      return this->transitionShared(pos).deepFire();
+    }
+    if (!compiled->acyclic()) {
+      throw std::runtime_error("Cycle detected");
+    }
+
+    if (!this->fire(index)) {
+      return false;
+    }
+    this->propagateParallel(*compiled, pos, pool);
+    return true;
+  }
+
+  ///
+  ///\brief execute tick() of every enabled transition once, by descending priority
+  ///
+  /// Resolves conflicts deterministically: of Transitions sharing an ingoing Place, the one with
+  /// the higher priority (then the lower handle) fires first. Only the enabled Transitions with
+  /// an autoFire() condition are scheduled (in a heap), the rest of the net is not visited.
+  /// Transitions disabled by an earlier firing are skipped without evaluating their condition,
+  /// Transitions enabled by it are scheduled by the next call.
+  ///
+  /// \see Transition::setPriority()
+  ///
+  void tickPrioritized() noexcept(false) {
+    // Local, so concurrent and nested calls (from conditions) do not share the schedule
+    std::vector<std::pair<int, std::size_t>> schedule;
+    // Max-heap: higher priority first, then lower position first
+    auto later = [](const auto &a, const auto &b) {
+      return a.first < b.first || (a.first == b.first && a.second > b.second);
+    };
+    {
+      std::shared_lock lock(this->state_->mutex);
+      auto tracking_lock = this->state_->lockTracking();
+
+      this->state_->forEachEnabled([&](std::size_t pos) {
+        const auto *transition = this->state_->transitions[pos];
+        if (transition->evaluate_condition_ != nullptr) {
+          schedule.emplace_back(transition->priority_, pos);
+        }
+      });
+    }
+    std::make_heap(begin(schedule), end(schedule), later);
+
+    while (!schedule.empty()) {
+      std::pop_heap(begin(schedule), end(schedule), later);
+      auto pos = schedule.back().second;
+      schedule.pop_back();
+      // Disabled by an earlier firing, do not evaluate its condition
+      if (this->ready(TransitionIndex(pos))) {
+        this->tickTransition(this->transitionShared(pos));
+      }
+    }
+  }
+
+  ///
+  ///\brief execute tick() of every transition queued since the last tickDirty()
+  ///
+  /// A Transition is queued when it is added, when the tokens of one of its ingoing Places
+  /// change, when autoFire() is set and when it is invalidate()d. Conditions depending on
+  /// anything else than the marking have to be invalidated by the user.
+  /// The queued transitions are ticked in ascending order, transitions queued while ticking
+  /// (e.g. consumers of fired transitions) are ticked by the next call.
+  ///
+  void tickDirty() noexcept(false) {
+    for (auto pos : this->takeDirty()) {
+      this->tickTransition(this->transitionShared(pos));
+    }
+  }
+
+  ///
+  ///\brief tick() the queued transitions until no transition fires anymore (works on cyclic nets)
+  ///
+  /// Like calling tickDirty() until the queue is empty: after a Transition fired, the consumers
+  /// of the changed places are ticked, too, only these are visited. Ends as soon as max_fires
+  /// Transitions fired, the Transitions not ticked yet stay queued for the next call.
+  ///
+  ///\param max_fires the maximum number of firings (step budget)
+  ///\return std::size_t the number of firings (if equal to max_fires, the net might not be
+  /// quiescent yet)
+  ///
+  std::size_t propagate(std::size_t max_fires = std::numeric_limits<std::size_t>::max()) noexcept(
+      false) {
+    std::size_t fired = 0;
+    while (fired < max_fires) {
+      auto ticking = this->takeDirty();
+      if (ticking.empty()) {
+        break;
+      }
+
+      for (auto it = cbegin(ticking); it != cend(ticking); ++it) {
+        if (fired == max_fires) {
+          // Budget exhausted, keep the rest queued
+          std::lock_guard lock(this->state_->mutex);
+          for (; it != cend(ticking); ++it) {
+            this->state_->markDirty(*it);
+          }
+          break;
+        }
+        if (this->tickTransition(this->transitionShared(*it))) {
+          ++fired;
+        }
+      }
     }
+    return fired;
   }
 
   ///
@@ -335,26 +1448,103 @@ public:
   ///
   /// When a Transition A on the Path fires, all Transitions that follow
   /// on any of the outgoing Places from A will fire, too.
-  /// NOTE: The PTN has to be acyclic, otherwise an exception will be thrown
+  /// NOTE: The PTN has to be acyclic, otherwise an exception will be thrown (see propagate() for
+  /// cyclic nets)
   ///
-  ///\param start_place_id the starting place id
+  ///\param start_place_id the starting place id (or any type usable for lookups)
   ///\throws std::runtime_error when cycles are detected
   ///\throws std::invalid_argument when the start_place_id was not found
   ///
-  void deepTick(IDT start_place_id) noexcept(false) {
+  template <typename K = IDT, typename = EnableIfLookupKeyT<K>>
+  void deepTick(const K &start_place_id) noexcept(false) {
     auto ptr = this->findPlace(start_place_id);
     if (ptr == nullptr) {
       throw std::invalid_argument("Start place ID not found");
     }
-    ptr->deepTick();
+
+    auto compiled = this->compiledNet();
+    if (compiled == nullptr) {
+      ptr->deepTick();
+      return;
+    }
+
+    CompiledGraph graph{this, compiled.get()};
+    this->state_->deepTick(static_cast<std::size_t>(ptr->getIndex()), graph);
   }
 
   ///
   ///\brief Execute deepTick() for every place
   ///
-  void deepTickCover() noexcept(true) {
-    for (const auto &place_ptr : this->places_) {
-      this->deepTick(place_ptr->getID());
+  /// On an acyclic compiled net with integral tokens, this is a single sweep over the
+  /// topological order computed by compile(): every Transition fires as often as the deep ticks
+  /// would tick it, as far as its tokens allow, in one go after all Transitions it may receive
+  /// tokens from. Its condition is evaluated once and its places notified once. Transitions
+  /// competing for tokens are served in topological order.
+  ///
+  ///\throws std::runtime_error when cycles are detected
+  ///
+  void deepTickCover() noexcept(false) {
+    auto compiled = this->compiledNet();
+    if (compiled == nullptr) {
+      for (std::size_t pos = 0; pos < this->state_->places.size(); ++pos) {
+        this->state_->places[pos]->deepTick();
+      }
+      return;
+    }
+
+    if constexpr (std::is_integral_v<TokenCounterT>) {
+      if (compiled->acyclic()) {
+        this->sweepTopologically(*compiled);
+        return;
+      }
+    }
+
+    CompiledGraph graph{this, compiled.get()};
+    for (std::size_t place = 0; place < compiled->placeCount(); ++place) {
+      this->state_->deepTick(place, graph);
+    }
+  }
+
+  ///
+  ///\brief Tick every Transition with ingoing arcs in the topological order computed by
+  /// compile(), each one again as long as it fires
+  ///
+  /// A single sweep, every Transition comes after all Transitions it may receive tokens from.
+  /// Unlike deepTickCover(), a Transition fires as often as it is ready instead of once per
+  /// firing upstream, and Transitions competing for tokens may resolve their conflicts
+  /// differently. Transitions without weighted ingoing arcs never run out of tokens, they are
+  /// ticked once. Any structural cycle is rejected, even one that would never fire.
+  ///
+  ///\throws std::logic_error if the net is not compiled
+  ///\throws std::runtime_error if the compiled net has a cycle (checked before ticking, see
+  /// isAcyclic())
+  ///
+  void tickTopological() noexcept(false) {
+    auto compiled = this->compiledNet();
+    if (compiled == nullptr) {
+      throw std::logic_error("Net not compiled");
+    }
+    if (!compiled->acyclic()) {
+      throw std::runtime_error("Cycle detected");
+    }
+
+    const auto &pre = compiled->pre();
+    for (auto pos : compiled->topologicalOrder()) {
+      if (pre.offsets[pos] == pre.offsets[pos + 1]) {
+        continue;  // a source would fire forever
+      }
+      const auto &transition = this->transitionShared(pos);
+      bool bounded = false;
+      {
+        std::lock_guard lock(this->state_->mutex);
+        bounded = transition.enablingDegreeAcquired().has_value();
+      }
+      if (!bounded) {
+        this->tickTransition(transition);
+        continue;
+      }
+      while (this->tickTransition(transition)) {
+      }
     }
   }
 };
@@ -9,22 +9,33 @@
 #ifndef SIMPLEPTN_INCLUDE_SIMPLEPTN_PLACE_HPP_
 #define SIMPLEPTN_INCLUDE_SIMPLEPTN_PLACE_HPP_
 
+#include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <memory>
-#include <set>
+#include <memory_resource>
+#include <shared_mutex>
 #include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "net_state.hpp"
+
 namespace sptn {
 
 template <typename ID, typename B> class Transition;
 
+///
+///\brief Dense handle of a Place inside its PetriNet (the n-th added Place)
+///
+enum class PlaceIndex : std::size_t {};
+
 ///
 ///\brief Class representing a PTN Place
 ///
 /// Objects of this class shall not be instanciated directly, \see sptn::PetriNet
+/// The tokens are not stored in the Place but in the marking of the NetState.
 ///
 ///\tparam IDT the ID type (must overload operator==)
 ///\tparam TokenCounterT the counting type (must overload operator+, operator- and operator<)
@@ -37,13 +48,23 @@ public:
   using IDT = ID;
   using TokenCounterT = TokenCounter;
   using TransitionT = Transition<IDT, TokenCounterT>;
+  using NetStateT = NetState<IDT, TokenCounterT>;
 
 private:
   IDT id_;
-  TokenCounterT tokens_;
+  PlaceIndex index_;
+  NetStateT *net_state_;
   std::function<void(const Place<IDT, TokenCounterT> &, TokenCounterT)> on_change_;
-  std::vector<std::shared_ptr<TransitionT>> outgoing_to_;
-  std::vector<std::shared_ptr<TransitionT>> ingoing_to_;
+  ///
+  ///\brief A Transition this Place is ingoing to
+  ///
+  struct Consumer {
+    TransitionT *transition;
+    TokenCounterT weight;
+  };
+
+  std::pmr::vector<TransitionT *> outgoing_to_;
+  std::pmr::vector<Consumer> ingoing_to_;
 
   ///
   ///\brief Call on_change_ if set
@@ -57,32 +78,110 @@ private:
   }
 
   ///
-  ///\brief Forward a deepTick to all transitions this place is positive incident to
+  ///\brief Check if an onChange listener is set
   ///
-  ///\param seen all seen places (cycle detection)
-  ///\throws std::runtime_error if cycles were detected
+  bool observed() const noexcept(true) { return this->on_change_ != nullptr; }
+
   ///
-  void deepTick(std::set<IDT> &seen) noexcept(false) {
-    if (seen.find(this->id_) != cend(seen)) {
-      throw std::runtime_error("Cycle detected");
-    }
+  ///\brief Access the tokens of this Place inside the marking (does not lock the mutex)
+  ///
+  ///\return TokenCounterT& the tokens
+  ///
+  TokenCounterT &tokensAcquired() const noexcept(true) {
+    return this->net_state_->marking[static_cast<std::size_t>(this->index_)];
+  }
 
-    seen.insert(this->id_);
+  ///
+  ///\brief Update the deficits of all consumers after the tokens changed (does not lock the
+  /// mutex)
+  ///
+  ///\param prev the previous token count
+  ///
+  void updateConsumersAcquired(const TokenCounterT &prev) const noexcept(true) {
+    this->updateConsumersAcquired(prev, this->tokensAcquired());
+  }
 
-    for (auto &transition : this->ingoing_to_) {
-      transition->deepTick(seen);
+  ///
+  ///\brief Update the deficits of all consumers after the tokens changed from prev to tokens
+  /// (does not lock the mutex)
+  ///
+  ///\param prev the previous token count
+  ///\param tokens the new token count
+  ///
+  void updateConsumersAcquired(const TokenCounterT &prev, const TokenCounterT &tokens) const
+      noexcept(true) {
+    if (!this->net_state_->track_changes) {
+      return;
     }
+    for (const auto &consumer : this->ingoing_to_) {
+      auto transition = static_cast<std::size_t>(consumer.transition->index_);
+      this->net_state_->tokensChanged(transition, consumer.weight, prev, tokens);
+    }
+  }
 
-    seen.erase(this->id_);
+  ///
+  ///\brief Update the deficits of all consumers after an atomic firing changed the tokens from
+  /// prev to tokens (requires the shared lock of the mutex or NetMutex::enterFast())
+  ///
+  ///\param prev the previous token count
+  ///\param tokens the new token count
+  ///
+  void updateConsumersAtomic(const TokenCounterT &prev, const TokenCounterT &tokens) const
+      noexcept(true) {
+    if (!this->net_state_->track_changes) {
+      return;
+    }
+    for (const auto &consumer : this->ingoing_to_) {
+      auto transition = static_cast<std::size_t>(consumer.transition->index_);
+      this->net_state_->tokensChangedAtomic(transition, consumer.weight, prev, tokens);
+    }
   }
 
+  ///
+  ///\brief The adjacency of the nodes owned by a NetState, for NetState::deepTick()
+  ///
+  struct NodeGraph {
+    NetStateT *state;
+
+    std::size_t placeCount() const noexcept(true) { return this->state->places.size(); }
+
+    std::size_t consumerCount(std::size_t place) const noexcept(true) {
+      return this->state->places[place]->ingoing_to_.size();
+    }
+
+    std::size_t consumer(std::size_t place, std::size_t i) const noexcept(true) {
+      return static_cast<std::size_t>(
+          this->state->places[place]->ingoing_to_[i].transition->getIndex());
+    }
+
+    std::size_t outputCount(std::size_t transition) const noexcept(true) {
+      return this->state->transitions[transition]->outgoing_.size();
+    }
+
+    std::size_t output(std::size_t transition, std::size_t i) const noexcept(true) {
+      return this->state->transitions[transition]->outgoing_[i].marking_pos;
+    }
+
+    bool tick(std::size_t transition) const noexcept(true) {
+      return this->state->transitions[transition]->tick();
+    }
+  };
+
   ///
   ///\brief Construct a new Place object
   ///
+  /// The tokens of the Place have to be stored in net_state->marking at position index.
+  ///
   ///\param id  the id
-  ///\param initial_tokens the initial number of tokens
+  ///\param index the dense handle inside the owning net
+  ///\param net_state the state of the owning net (must outlive the Place)
   ///
-  Place(const IDT &id, TokenCounterT initial_tokens) : id_(id), tokens_(initial_tokens) {}
+  Place(IDT id, PlaceIndex index, NetStateT *net_state)
+      : id_(std::move(id)),
+        index_(index),
+        net_state_(net_state),
+        outgoing_to_(&net_state->arena),
+        ingoing_to_(&net_state->arena) {}
 
 public:
   ///
@@ -90,7 +189,12 @@ public:
   ///
   ///\return TokenCounterT the amount
   ///
-  [[nodiscard]] TokenCounterT getTokens() const noexcept(true) { return this->tokens_; }
+  [[nodiscard]] TokenCounterT getTokens() const noexcept(true) {
+    std::shared_lock lock(this->net_state_->mutex);
+    auto pos = static_cast<std::size_t>(this->index_);
+    auto place_lock = this->net_state_->lockPlace(pos);
+    return this->net_state_->loadTokens(pos);
+  }
 
   ///
   ///\brief Set the active onChange listener (args: (Place, prev_tokens))
@@ -111,14 +215,23 @@ public:
   ///
   [[nodiscard]] const IDT &getID() const noexcept(true) { return this->id_; }
 
+  ///
+  ///\brief Get the Place's dense handle inside its PetriNet
+  ///
+  ///\return PlaceIndex
+  ///
+  [[nodiscard]] PlaceIndex getIndex() const noexcept(true) { return this->index_; }
+
   ///
   ///\brief Forward a deepTick to all transitions this place is positive incident to
   ///
+  /// The traversal is iterative and does not allocate once its storage has grown.
+  ///
   ///\throws std::runtime_error if cycles were detected
   ///
   void deepTick() noexcept(false) {
-    std::set<IDT> seen;
-    this->deepTick(seen);
+    NodeGraph graph{this->net_state_};
+    this->net_state_->deepTick(static_cast<std::size_t>(this->index_), graph);
   }
 };
 
@@ -0,0 +1,171 @@
+// Copyright Open Logistics Foundation
+// 
+// Licensed under the Open Logistics Foundation License 1.3.
+// For details on the licensing terms, see the LICENSE file.
+// SPDX-License-Identifier: OLFL-1.3
+// 
+// This file contains the kernels evaluating the arcs of a whole net at once
+
+#ifndef SIMPLEPTN_INCLUDE_SIMPLEPTN_READY_KERNELS_HPP_
+#define SIMPLEPTN_INCLUDE_SIMPLEPTN_READY_KERNELS_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// Vectorized kernels are compiled with function level target attributes and chosen at runtime,
+// define SIMPLEPTN_NO_SIMD to only use the scalar kernel
+#if !defined(SIMPLEPTN_NO_SIMD) && (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__GNUC__) || defined(__clang__))
+#define SIMPLEPTN_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+namespace sptn::kernels {
+
+///
+///\brief The implementations of unsatisfiedArcs()
+///
+enum class Kernel { k_scalar, k_sse41, k_avx2 };
+
+///
+///\brief Get the fastest kernel supported by the CPU (detected once)
+///
+inline Kernel detect() noexcept(true) {
+#ifdef SIMPLEPTN_X86_KERNELS
+  static const Kernel kernel = []() {
+    if (__builtin_cpu_supports("avx2")) {
+      return Kernel::k_avx2;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+      return Kernel::k_sse41;
+    }
+    return Kernel::k_scalar;
+  }();
+  return kernel;
+#else
+  return Kernel::k_scalar;
+#endif
+}
+
+///
+///\brief Check if a kernel can run on this CPU
+///
+inline bool supported(Kernel kernel) noexcept(true) {
+  return static_cast<int>(kernel) <= static_cast<int>(detect());
+}
+
+///
+///\brief Mark the unsatisfied arcs (scalar kernel)
+///
+///\param marking the tokens, indexed by place
+///\param places the place of each arc
+///\param weights the weight of each arc
+///\param count the number of arcs
+///\param out receives bit i if marking[places[i]] < weights[i] (must be zeroed)
+///
+template <typename TokenCounterT, typename PosT>
+void unsatisfiedArcsScalar(const TokenCounterT *marking, const PosT *places,
+                           const TokenCounterT *weights, std::size_t count,
+                           std::uint64_t *out) noexcept(true) {
+  for (std::size_t i = 0; i < count; ++i) {
+    if (marking[places[i]] < weights[i]) {
+      out[i / 64] |= std::uint64_t{1} << (i % 64);
+    }
+  }
+}
+
+#ifdef SIMPLEPTN_X86_KERNELS
+
+///
+///\brief Mark the unsatisfied arcs, 4 at once (SSE4.1 kernel, \see unsatisfiedArcsScalar())
+///
+__attribute__((target("sse4.1"))) inline void unsatisfiedArcsSse41(
+    const std::uint32_t *marking, const std::uint32_t *places, const std::uint32_t *weights,
+    std::size_t count, std::uint64_t *out) noexcept(true) {
+  std::size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    // SSE has no gather instruction
+    auto tokens = _mm_set_epi32(static_cast<int>(marking[places[i + 3]]),
+                                static_cast<int>(marking[places[i + 2]]),
+                                static_cast<int>(marking[places[i + 1]]),
+                                static_cast<int>(marking[places[i]]));
+    auto weight = _mm_loadu_si128(reinterpret_cast<const __m128i *>(weights + i));
+    // Unsigned tokens >= weight
+    auto satisfied = _mm_cmpeq_epi32(_mm_max_epu32(tokens, weight), tokens);
+    auto bits = ~static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(satisfied))) & 0xFU;
+    out[i / 64] |= std::uint64_t{bits} << (i % 64);
+  }
+  for (; i < count; ++i) {
+    if (marking[places[i]] < weights[i]) {
+      out[i / 64] |= std::uint64_t{1} << (i % 64);
+    }
+  }
+}
+
+///
+///\brief Mark the unsatisfied arcs, 8 at once (AVX2 kernel, \see unsatisfiedArcsScalar())
+///
+/// All place indices must fit into int32_t.
+///
+__attribute__((target("avx2"))) inline void unsatisfiedArcsAvx2(
+    const std::uint32_t *marking, const std::uint32_t *places, const std::uint32_t *weights,
+    std::size_t count, std::uint64_t *out) noexcept(true) {
+  std::size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    auto index = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(places + i));
+    auto tokens = _mm256_i32gather_epi32(reinterpret_cast<const int *>(marking), index, 4);
+    auto weight = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(weights + i));
+    // Unsigned tokens >= weight
+    auto satisfied = _mm256_cmpeq_epi32(_mm256_max_epu32(tokens, weight), tokens);
+    auto bits =
+        ~static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(satisfied))) & 0xFFU;
+    out[i / 64] |= std::uint64_t{bits} << (i % 64);
+  }
+  for (; i < count; ++i) {
+    if (marking[places[i]] < weights[i]) {
+      out[i / 64] |= std::uint64_t{1} << (i % 64);
+    }
+  }
+}
+
+#endif
+
+///
+///\brief Mark the unsatisfied arcs with the given kernel
+///
+/// The vectorized kernels are used for uint32_t tokens only, otherwise and if the kernel is not
+/// supported the scalar kernel runs. The arcs have to start at a multiple of 64 if out is a part
+/// of a larger bitmap.
+///
+///\param kernel the kernel to use
+///\param marking the tokens, indexed by place (all place indices must fit into int32_t)
+///\param places the place of each arc
+///\param weights the weight of each arc
+///\param count the number of arcs
+///\param out receives bit i if marking[places[i]] < weights[i] (must be zeroed)
+///
+template <typename TokenCounterT, typename PosT>
+void unsatisfiedArcs(Kernel kernel, const TokenCounterT *marking, const PosT *places,
+                     const TokenCounterT *weights, std::size_t count,
+                     std::uint64_t *out) noexcept(true) {
+#ifdef SIMPLEPTN_X86_KERNELS
+  if constexpr (std::is_same_v<TokenCounterT, std::uint32_t> &&
+                std::is_same_v<PosT, std::uint32_t>) {
+    if (kernel == Kernel::k_avx2 && supported(kernel)) {
+      unsatisfiedArcsAvx2(marking, places, weights, count, out);
+      return;
+    }
+    if (kernel == Kernel::k_sse41 && supported(kernel)) {
+      unsatisfiedArcsSse41(marking, places, weights, count, out);
+      return;
+    }
+  }
+#endif
+  (void)kernel;
+  unsatisfiedArcsScalar(marking, places, weights, count, out);
+}
+
+}  // namespace sptn::kernels
+
+#endif  // SIMPLEPTN_INCLUDE_SIMPLEPTN_READY_KERNELS_HPP_
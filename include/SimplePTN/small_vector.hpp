@@ -0,0 +1,253 @@
+// Copyright Open Logistics Foundation
+// 
+// Licensed under the Open Logistics Foundation License 1.3.
+// For details on the licensing terms, see the LICENSE file.
+// SPDX-License-Identifier: OLFL-1.3
+// 
+// This file contains the SmallVector class
+
+#ifndef SIMPLEPTN_INCLUDE_SIMPLEPTN_SMALL_VECTOR_HPP_
+#define SIMPLEPTN_INCLUDE_SIMPLEPTN_SMALL_VECTOR_HPP_
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <utility>
+
+namespace sptn {
+
+///
+///\brief Vector which stores up to N elements inline
+///
+/// Only if more than N elements are stored, the elements are moved to memory requested from a
+/// std::pmr::memory_resource (spill).
+///
+///\tparam T the element type (copied on reallocation if moving may throw)
+///\tparam N the inline capacity
+///
+template <typename T, std::size_t N> class SmallVector {
+  static_assert(N > 0, "SmallVector needs an inline capacity");
+
+public:
+  using value_type = T;
+  using size_type = std::size_t;
+  using iterator = T *;
+  using const_iterator = const T *;
+
+  ///\brief the inline capacity
+  static constexpr std::size_t k_inline_capacity = N;
+
+private:
+  alignas(T) unsigned char inline_[N * sizeof(T)];
+  T *data_;
+  std::size_t size_ = 0;
+  std::size_t capacity_ = N;
+  std::pmr::memory_resource *resource_;
+
+  T *inlineData() noexcept(true) { return std::launder(reinterpret_cast<T *>(this->inline_)); }
+
+  ///
+  ///\brief Destroy all elements and release spilled memory (leaves the vector in an invalid
+  /// state)
+  ///
+  void release() noexcept(true) {
+    std::destroy_n(this->data_, this->size_);
+    if (this->spilled()) {
+      this->resource_->deallocate(this->data_, this->capacity_ * sizeof(T), alignof(T));
+    }
+  }
+
+  ///
+  ///\brief Allocate memory for n elements from the resource
+  ///
+  T *allocateSpill(std::size_t n) noexcept(false) {
+    return static_cast<T *>(this->resource_->allocate(n * sizeof(T), alignof(T)));
+  }
+
+  ///
+  ///\brief Move the elements to uninitialized memory (copy them if moving may throw, so the
+  /// elements stay intact if constructing one of them fails)
+  ///
+  ///\param to memory for at least size_ elements
+  ///
+  void relocateTo(T *to) noexcept(false) {
+    std::size_t i = 0;
+    try {
+      for (; i < this->size_; ++i) {
+        new (to + i) T(std::move_if_noexcept(this->data_[i]));
+      }
+    } catch (...) {
+      std::destroy_n(to, i);
+      throw;
+    }
+  }
+
+  ///
+  ///\brief Replace the storage by relocated elements (release the current ones)
+  ///
+  ///\param spill the memory the elements were relocated to
+  ///\param capacity the capacity of spill
+  ///
+  void adopt(T *spill, std::size_t capacity) noexcept(true) {
+    auto size = this->size_;
+    this->release();
+    this->data_ = spill;
+    this->size_ = size;
+    this->capacity_ = capacity;
+  }
+
+  ///
+  ///\brief Take the elements of another vector (this has to be empty and inline)
+  ///
+  void take(SmallVector &&other) noexcept(false) {
+    if (other.spilled() && *other.resource_ == *this->resource_) {
+      this->data_ = other.data_;
+      this->size_ = other.size_;
+      this->capacity_ = other.capacity_;
+      other.data_ = other.inlineData();
+      other.size_ = 0;
+      other.capacity_ = N;
+      return;
+    }
+
+    this->reserve(other.size_);
+    std::uninitialized_move_n(other.data_, other.size_, this->data_);
+    this->size_ = other.size_;
+    other.clear();
+  }
+
+public:
+  ///
+  ///\brief Construct an empty SmallVector
+  ///
+  ///\param resource the resource spilled elements are allocated from (must outlive the vector)
+  ///
+  explicit SmallVector(
+      std::pmr::memory_resource *resource = std::pmr::get_default_resource()) noexcept(true)
+      : data_(inlineData()), resource_(resource) {}
+
+  SmallVector(SmallVector &&other) noexcept(false)
+      : data_(inlineData()), resource_(other.resource_) {
+    this->take(std::move(other));
+  }
+
+  ///
+  ///\brief Move all elements to this vector (keeps the resource of this vector)
+  ///
+  ///\param other the vector to move from (empty afterwards)
+  ///
+  SmallVector &operator=(SmallVector &&other) noexcept(false) {
+    if (this != &other) {
+      this->release();
+      this->data_ = this->inlineData();
+      this->size_ = 0;
+      this->capacity_ = N;
+      this->take(std::move(other));
+    }
+    return *this;
+  }
+
+  SmallVector(const SmallVector &) = delete;
+  SmallVector &operator=(const SmallVector &) = delete;
+
+  ~SmallVector() { this->release(); }
+
+  ///
+  ///\brief Make sure n elements fit without reallocation
+  ///
+  ///\param n the number of elements
+  ///
+  void reserve(std::size_t n) noexcept(false) {
+    if (n <= this->capacity_) {
+      return;
+    }
+
+    auto *spill = this->allocateSpill(n);
+    try {
+      this->relocateTo(spill);
+    } catch (...) {
+      this->resource_->deallocate(spill, n * sizeof(T), alignof(T));
+      throw;
+    }
+    this->adopt(spill, n);
+  }
+
+  ///
+  ///\brief Construct a new element at the end
+  ///
+  ///\return T& the new element
+  ///
+  template <typename... Args> T &emplace_back(Args &&...args) noexcept(false) {
+    if (this->size_ < this->capacity_) {
+      auto *element = new (this->data_ + this->size_) T(std::forward<Args>(args)...);
+      ++this->size_;
+      return *element;
+    }
+
+    // Construct the new element first, args may refer to the current elements
+    auto capacity = 2 * this->capacity_;
+    auto *spill = this->allocateSpill(capacity);
+    T *element = nullptr;
+    try {
+      element = new (spill + this->size_) T(std::forward<Args>(args)...);
+      this->relocateTo(spill);
+    } catch (...) {
+      if (element != nullptr) {
+        std::destroy_at(element);
+      }
+      this->resource_->deallocate(spill, capacity * sizeof(T), alignof(T));
+      throw;
+    }
+    this->adopt(spill, capacity);
+    ++this->size_;
+    return *element;
+  }
+
+  void push_back(const T &value) noexcept(false) { this->emplace_back(value); }
+  void push_back(T &&value) noexcept(false) { this->emplace_back(std::move(value)); }
+
+  ///
+  ///\brief Remove the last element (keeps the capacity)
+  ///
+  void pop_back() noexcept(true) {
+    --this->size_;
+    std::destroy_at(this->data_ + this->size_);
+  }
+
+  ///
+  ///\brief Remove all elements (keeps the capacity)
+  ///
+  void clear() noexcept(true) {
+    std::destroy_n(this->data_, this->size_);
+    this->size_ = 0;
+  }
+
+  ///
+  ///\brief Check if the elements are stored outside of the vector
+  ///
+  [[nodiscard]] bool spilled() const noexcept(true) {
+    return this->data_ != reinterpret_cast<const T *>(this->inline_);
+  }
+
+  [[nodiscard]] std::size_t size() const noexcept(true) { return this->size_; }
+  [[nodiscard]] std::size_t capacity() const noexcept(true) { return this->capacity_; }
+  [[nodiscard]] bool empty() const noexcept(true) { return this->size_ == 0; }
+
+  [[nodiscard]] T *data() noexcept(true) { return this->data_; }
+  [[nodiscard]] const T *data() const noexcept(true) { return this->data_; }
+
+  T &operator[](std::size_t pos) noexcept(true) { return this->data_[pos]; }
+  const T &operator[](std::size_t pos) const noexcept(true) { return this->data_[pos]; }
+
+  iterator begin() noexcept(true) { return this->data_; }
+  iterator end() noexcept(true) { return this->data_ + this->size_; }
+  const_iterator begin() const noexcept(true) { return this->data_; }
+  const_iterator end() const noexcept(true) { return this->data_ + this->size_; }
+  const_iterator cbegin() const noexcept(true) { return this->data_; }
+  const_iterator cend() const noexcept(true) { return this->data_ + this->size_; }
+};
+
+}  // namespace sptn
+
+#endif  // SIMPLEPTN_INCLUDE_SIMPLEPTN_SMALL_VECTOR_HPP_
@@ -0,0 +1,311 @@
+// Copyright Open Logistics Foundation
+// 
+// Licensed under the Open Logistics Foundation License 1.3.
+// For details on the licensing terms, see the LICENSE file.
+// SPDX-License-Identifier: OLFL-1.3
+// 
+// This file contains the ThreadPool class
+
+#ifndef SIMPLEPTN_INCLUDE_SIMPLEPTN_THREAD_POOL_HPP_
+#define SIMPLEPTN_INCLUDE_SIMPLEPTN_THREAD_POOL_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sptn {
+
+///
+///\brief Fixed set of worker threads running parallel loops and tasks, \see
+/// PetriNet::parallelTick() and PetriNet::parallelDeepTick()
+///
+/// The calling thread takes part in every loop, so a pool of size n starts n - 1 threads.
+/// Loops (and task runs) of different threads run one after another, a loop body or task must
+/// not start a loop on the same pool.
+///
+class ThreadPool {
+  ///\brief a type erased loop, run by every thread once per generation (thread 0 is the caller)
+  struct Job {
+    void (*run)(void *context, std::size_t thread);
+    void *context;
+  };
+
+  ///\brief the tasks of one thread, the owner takes the newest, thieves take the oldest
+  struct TaskQueue {
+    std::mutex mutex;
+    std::deque<std::size_t> tasks;
+  };
+
+  std::vector<std::thread> workers_;
+  std::unique_ptr<TaskQueue[]> queues_;  // one per thread
+  std::mutex loop_mutex_;  // serializes the loops and guards queues_
+  std::mutex mutex_;       // guards the members below
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  Job job_{nullptr, nullptr};
+  std::uint64_t generation_ = 0;
+  std::size_t running_ = 0;
+  bool stop_ = false;
+
+  void work(std::size_t thread) noexcept(true) {
+    std::uint64_t seen = 0;
+    std::unique_lock lock(this->mutex_);
+    for (;;) {
+      this->wake_.wait(lock, [&]() { return this->stop_ || this->generation_ != seen; });
+      if (this->stop_) {
+        return;
+      }
+      seen = this->generation_;
+      auto job = this->job_;
+      lock.unlock();
+      job.run(job.context, thread);
+      lock.lock();
+      if (--this->running_ == 0) {
+        this->done_.notify_all();
+      }
+    }
+  }
+
+public:
+  ///
+  ///\brief Construct a new ThreadPool
+  ///
+  ///\param size the number of threads running a loop, including the calling thread (at least 1)
+  ///
+  explicit ThreadPool(std::size_t size = std::thread::hardware_concurrency()) noexcept(false) {
+    size = std::max<std::size_t>(size, 1);
+    this->queues_ = std::make_unique<TaskQueue[]>(size);
+    this->workers_.reserve(size - 1);
+    try {
+      for (std::size_t i = 1; i < size; ++i) {
+        this->workers_.emplace_back([this, i]() { this->work(i); });
+      }
+    } catch (...) {
+      this->stop();
+      throw;
+    }
+  }
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  ~ThreadPool() { this->stop(); }
+
+  ///
+  ///\brief Get the number of threads running a loop (including the calling thread)
+  ///
+  [[nodiscard]] std::size_t size() const noexcept(true) { return this->workers_.size() + 1; }
+
+  ///
+  ///\brief Call fn(i) for every i in [0, count) on all threads and wait for all calls
+  ///
+  /// The indices are handed out in chunks. If a call throws, the remaining chunks are skipped
+  /// and the first exception is rethrown.
+  ///
+  ///\param count the number of indices
+  ///\param fn the loop body
+  ///
+  template <typename Fn> void parallelFor(std::size_t count, Fn &&fn) noexcept(false) {
+    if (count == 0) {
+      return;
+    }
+
+    auto chunk = std::max<std::size_t>(1, count / (4 * this->size()));
+    std::atomic<std::size_t> next = 0;
+    std::mutex error_mutex;
+    std::exception_ptr error;
+
+    auto run = [&](std::size_t /*thread*/) {
+      for (;;) {
+        auto begin = next.fetch_add(chunk);
+        if (begin >= count) {
+          return;
+        }
+        try {
+          for (auto i = begin; i < std::min(count, begin + chunk); ++i) {
+            fn(i);
+          }
+        } catch (...) {
+          std::lock_guard lock(error_mutex);
+          if (error == nullptr) {
+            error = std::current_exception();
+          }
+          next = count;
+          return;
+        }
+      }
+    };
+
+    if (this->workers_.empty() || count <= chunk) {
+      run(0);
+    } else {
+      std::lock_guard loop_lock(this->loop_mutex_);
+      this->runOnAllThreads(run);
+    }
+
+    if (error != nullptr) {
+      std::rethrow_exception(error);
+    }
+  }
+
+  ///
+  ///\brief Run tasks which may spawn further tasks on all threads until no task is left
+  ///
+  /// Every thread owns a deque: spawned tasks are pushed to the deque of the spawning thread,
+  /// which continues with its newest task (depth-first). Idle threads steal the oldest tasks of
+  /// the other threads, so a single task fanning out keeps all threads busy. Threads finding no
+  /// task sleep until a task is spawned or all tasks are done.
+  /// If a call throws, the remaining tasks are dropped and the first exception is rethrown.
+  ///
+  ///\param tasks the initial tasks
+  ///\param fn the task body, called as fn(task, spawn) where spawn(task) queues another task
+  ///
+  template <typename Fn>
+  void runTasks(const std::vector<std::size_t> &tasks, Fn &&fn) noexcept(false) {
+    if (tasks.empty()) {
+      return;
+    }
+
+    std::lock_guard loop_lock(this->loop_mutex_);
+    auto threads = this->size();
+    std::atomic<std::size_t> pending = tasks.size();  // queued or running
+    std::atomic<std::size_t> queued = tasks.size();
+    std::atomic<bool> failed = false;
+    std::mutex error_mutex;
+    std::exception_ptr error;
+    std::mutex idle_mutex;
+    std::condition_variable idle;
+    std::atomic<std::size_t> sleeping = 0;  // changed while holding idle_mutex
+
+    for (std::size_t i = 0; i < tasks.size(); ++i) {
+      this->queues_[i % threads].tasks.push_back(tasks[i]);
+    }
+
+    auto take = [&](std::size_t thread, std::size_t &task) {
+      for (std::size_t i = 0; i < threads; ++i) {
+        auto &queue = this->queues_[(thread + i) % threads];
+        std::lock_guard lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+          if (i == 0) {
+            task = queue.tasks.back();
+            queue.tasks.pop_back();
+          } else {
+            task = queue.tasks.front();
+            queue.tasks.pop_front();
+          }
+          queued.fetch_sub(1);
+          return true;
+        }
+      }
+      return false;
+    };
+
+    auto wake_all = [&]() {
+      std::lock_guard lock(idle_mutex);
+      idle.notify_all();
+    };
+
+    auto run = [&](std::size_t thread) {
+      auto &own = this->queues_[thread];
+      auto spawn = [&](std::size_t task) {
+        pending.fetch_add(1);
+        {
+          std::lock_guard lock(own.mutex);
+          own.tasks.push_back(task);
+        }
+        // A sleeper counted after this increment sees the task before waiting
+        queued.fetch_add(1);
+        if (sleeping.load() != 0) {
+          std::lock_guard lock(idle_mutex);
+          idle.notify_one();
+        }
+      };
+
+      std::size_t task = 0;
+      while (pending.load() != 0 && !failed.load()) {
+        if (!take(thread, task)) {
+          std::unique_lock lock(idle_mutex);
+          sleeping.fetch_add(1);
+          idle.wait(lock, [&]() {
+            return queued.load() != 0 || pending.load() == 0 || failed.load();
+          });
+          sleeping.fetch_sub(1);
+          continue;
+        }
+        try {
+          fn(task, spawn);
+        } catch (...) {
+          {
+            std::lock_guard lock(error_mutex);
+            if (error == nullptr) {
+              error = std::current_exception();
+            }
+          }
+          failed = true;
+          wake_all();
+        }
+        if (pending.fetch_sub(1) == 1) {
+          wake_all();
+        }
+      }
+    };
+
+    if (this->workers_.empty()) {
+      run(0);
+    } else {
+      this->runOnAllThreads(run);
+    }
+
+    if (error != nullptr) {
+      for (std::size_t i = 0; i < threads; ++i) {
+        this->queues_[i].tasks.clear();
+      }
+      std::rethrow_exception(error);
+    }
+  }
+
+private:
+  ///
+  ///\brief Run run(thread) on the calling thread (0) and all workers, wait until all returned
+  /// (requires loop_mutex_)
+  ///
+  template <typename Run> void runOnAllThreads(Run &run) noexcept(true) {
+    {
+      std::lock_guard lock(this->mutex_);
+      this->job_ = {[](void *context, std::size_t thread) {
+                      (*static_cast<Run *>(context))(thread);
+                    },
+                    &run};
+      this->running_ = this->workers_.size();
+      ++this->generation_;
+    }
+    this->wake_.notify_all();
+    run(0);
+
+    std::unique_lock lock(this->mutex_);
+    this->done_.wait(lock, [&]() { return this->running_ == 0; });
+  }
+
+  void stop() noexcept(true) {
+    {
+      std::lock_guard lock(this->mutex_);
+      this->stop_ = true;
+    }
+    this->wake_.notify_all();
+    for (auto &worker : this->workers_) {
+      worker.join();
+    }
+  }
+};
+
+}  // namespace sptn
+
+#endif  // SIMPLEPTN_INCLUDE_SIMPLEPTN_THREAD_POOL_HPP_
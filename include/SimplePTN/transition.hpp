@@ -9,16 +9,32 @@
 #ifndef THIRD_PARTY_SIMPLEPTN_INCLUDE_SIMPLEPTN_TRANSITION_HPP_
 #define THIRD_PARTY_SIMPLEPTN_INCLUDE_SIMPLEPTN_TRANSITION_HPP_
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
 #include <shared_mutex>
 #include <string>
+#include <type_traits>
 #include <vector>
 
+#include "atomic_ops.hpp"
+#include "net_state.hpp"
 #include "place.hpp"
+#include "small_vector.hpp"
 
 namespace sptn {
 
+///
+///\brief Dense handle of a Transition inside its PetriNet (the n-th added Transition)
+///
+enum class TransitionIndex : std::size_t {};
+
 ///
 ///\brief Class representing a PTN Transition
 ///
@@ -32,28 +48,69 @@ public:
   using IDT = ID;
   using TokenCounterT = TokenCounter;
   using PlaceT = Place<IDT, TokenCounterT>;
-  using WeightPairT = std::pair<std::shared_ptr<PlaceT>, TokenCounterT>;
+  using NetStateT = NetState<IDT, TokenCounterT>;
+  using WeightPairT = std::pair<PlaceT *, TokenCounterT>;
   template <typename A, typename B> friend class PetriNet;
   template <typename A, typename B> friend class Place;
 
 private:
+  ///
+  ///\brief An arc between this Transition and a Place
+  ///
+  /// The marking position is kept next to the weight, so ready() and fire() only read
+  /// the arcs and the marking without dereferencing the Place.
+  ///
+  struct Arc {
+    PlaceT *place;
+    std::size_t marking_pos;
+    TokenCounterT weight;
+  };
+
+  ///\brief the arcs of one direction, the common fan-in/fan-out is stored inline
+  using ArcsT = SmallVector<Arc, 3>;
+
   IDT id_;
-  std::vector<WeightPairT> ingoing_;
-  std::vector<WeightPairT> outgoing_;
+  TransitionIndex index_;
+  ArcsT ingoing_;
+  ArcsT outgoing_;
   std::function<bool(const Transition<IDT, TokenCounterT> &)> evaluate_condition_;
-  std::shared_ptr<std::shared_mutex> net_mutex_;
+  NetStateT *net_state_;
+  int priority_ = 0;
+
+  ///\brief changed places with listeners, kept on the stack for the common fan-in/fan-out
+  using NotifyListT = SmallVector<std::pair<PlaceT *, TokenCounterT>, 8>;
+
+  ///
+  ///\brief Create the arcs from weight pairs
+  ///
+  static ArcsT toArcs(const std::vector<WeightPairT> &pairs,
+                      std::pmr::memory_resource *resource) noexcept(false) {
+    ArcsT arcs(resource);
+    arcs.reserve(pairs.size());
+    for (auto &[place, weight] : pairs) {
+      auto pos = static_cast<std::size_t>(place->getIndex());
+      arcs.push_back(Arc{place, pos, weight});
+    }
+    return arcs;
+  }
 
   ///
   ///\brief Construct a new Transition with ingoing and outgoing weight pairs
   ///
   ///\param id the Transition ID
+  ///\param index the dense handle inside the owning net
   ///\param ingoing the ingoing Places with weights
   ///\param outgoing  the outgoing Places with weights
-  ///\param net_mutex the Mutex of the PetriNet
-  ///
-  Transition(const IDT &id, std::vector<WeightPairT> &&ingoing, std::vector<WeightPairT> &&outgoing,
-             std::shared_ptr<std::shared_mutex> net_mutex)
-      : id_(id), ingoing_(ingoing), outgoing_(outgoing), net_mutex_(net_mutex) {}
+  ///\param net_state the state of the PetriNet (all places must be part of it, must outlive the
+  /// Transition)
+  ///
+  Transition(IDT id, TransitionIndex index, const std::vector<WeightPairT> &ingoing,
+             const std::vector<WeightPairT> &outgoing, NetStateT *net_state)
+      : id_(std::move(id)),
+        index_(index),
+        ingoing_(toArcs(ingoing, &net_state->arena)),
+        outgoing_(toArcs(outgoing, &net_state->arena)),
+        net_state_(net_state) {}
 
   Transition(Transition<IDT, TokenCounterT> &&from) { *this = std::move(from); }
 
@@ -64,22 +121,46 @@ private:
   ///
   void operator=(Transition<IDT, TokenCounterT> &&from) {
     this->id_ = std::move(from.id_);
+    this->index_ = from.index_;
     this->ingoing_ = std::move(from.ingoing_);
     this->outgoing_ = std::move(from.outgoing_);
     this->evaluate_condition_ = std::move(from.evaluate_condition_);
+    this->net_state_ = from.net_state_;
+    this->priority_ = from.priority_;
   }
 
   void operator=(const Transition<IDT, TokenCounterT> &from) = delete;
 
+  ///
+  ///\brief Count the unsatisfied ingoing arcs (does not lock mutex)
+  ///
+  std::size_t countDeficitAcquired() const noexcept(true) {
+    const auto &marking = this->net_state_->marking;
+    std::size_t deficit = 0;
+    for (const auto &arc : this->ingoing_) {
+      if (marking[arc.marking_pos] < arc.weight) {
+        ++deficit;
+      }
+    }
+    return deficit;
+  }
+
   ///
   ///\brief Perform ready() check (does not lock mutex)
   ///
+  /// O(1) if the net tracks the enabled transitions, otherwise all ingoing arcs are checked.
+  ///
   ///\return true
   ///\return false
   ///
   bool readyAcquired() const noexcept(true) {
-    for (auto &[place, weight] : ingoing_) {
-      if (place->tokens_ < weight) {
+    if (this->net_state_->track_changes) {
+      return this->net_state_->loadDeficit(static_cast<std::size_t>(this->index_)) == 0;
+    }
+
+    const auto &marking = this->net_state_->marking;
+    for (const auto &arc : this->ingoing_) {
+      if (marking[arc.marking_pos] < arc.weight) {
         return false;
       }
     }
@@ -88,18 +169,434 @@ private:
   }
 
   ///
-  ///\brief Tick this transition, then deepTick all transitions that might
-  /// have become ready.
+  ///\brief Change the tokens of the places of some arcs (does not lock mutex)
+  ///
+  ///\param arcs the arcs to apply
+  ///\param change the change of the tokens (tokens, weight) -> tokens
+  ///\param places_to_notify receives all changed places with a listener and their previous
+  /// token count
+  ///
+  template <typename Change>
+  void applyAcquired(const ArcsT &arcs, Change change, NotifyListT &places_to_notify) const
+      noexcept(false) {
+    auto &marking = this->net_state_->marking;
+    for (const auto &arc : arcs) {
+      auto &tokens = marking[arc.marking_pos];
+      auto prev = tokens;
+      tokens = change(tokens, arc.weight);
+      arc.place->updateConsumersAcquired(prev);
+      if (arc.place->observed()) {
+        places_to_notify.push_back(std::make_pair(arc.place, prev));
+      }
+    }
+  }
+
   ///
-  ///\param std::set<IDT> &seen all places encountered so far (cycle detection)
-  ///\throws std::runtime_error if cycles were detected
+  ///\brief Remove the tokens of the ingoing arcs without checking if ready (does not lock mutex)
   ///
-  void deepTick(std::set<IDT> &seen) {
-    if (this->tick()) {
-      for (auto &[place, _] : this->outgoing_) {
-        place->deepTick(seen);
+  ///\param places_to_notify receives all changed places with a listener and their previous
+  /// token count
+  ///
+  void consumeAcquired(NotifyListT &places_to_notify) const noexcept(false) {
+    this->applyAcquired(
+        this->ingoing_, [](const auto &tokens, const auto &weight) { return tokens - weight; },
+        places_to_notify);
+  }
+
+  ///
+  ///\brief Add the tokens of the outgoing arcs (does not lock mutex)
+  ///
+  ///\param places_to_notify receives all changed places with a listener and their previous
+  /// token count
+  ///
+  void produceAcquired(NotifyListT &places_to_notify) const noexcept(false) {
+    this->applyAcquired(
+        this->outgoing_, [](const auto &tokens, const auto &weight) { return tokens + weight; },
+        places_to_notify);
+  }
+
+  ///
+  ///\brief Fire this Transition if ready (does not lock mutex)
+  ///
+  ///\param places_to_notify receives all changed places with a listener and their previous
+  /// token count
+  ///\return true fired
+  ///\return false not ready
+  ///
+  bool fireAcquired(NotifyListT &places_to_notify) const noexcept(false) {
+    if (!this->readyAcquired()) {
+      return false;
+    }
+
+    this->consumeAcquired(places_to_notify);
+    this->produceAcquired(places_to_notify);
+    return true;
+  }
+
+  ///
+  ///\brief Check if firing locks the places of this Transition (instead of taking the mutex of
+  /// the net exclusively)
+  ///
+  bool locksPlaces() const noexcept(true) {
+    return this->net_state_->locksPlaces() &&
+           this->ingoing_.size() + this->outgoing_.size() <= NetStateT::k_max_place_locks;
+  }
+
+  ///\brief the lock (or version) positions of the places of a Transition
+  using StripesT = SmallVector<std::size_t, 8>;
+
+  ///
+  ///\brief Get the distinct lock (or version) positions of all places in ascending order
+  ///
+  ///\param stripes receives the positions (must be empty)
+  ///
+  void placeStripes(StripesT &stripes) const noexcept(false) {
+    for (const auto *arcs : {&this->ingoing_, &this->outgoing_}) {
+      for (const auto &arc : *arcs) {
+        stripes.push_back(NetStateT::placeStripe(arc.marking_pos));
+      }
+    }
+    std::sort(stripes.begin(), stripes.end());
+    auto last = std::unique(stripes.begin(), stripes.end());
+    while (stripes.end() != last) {
+      stripes.pop_back();
+    }
+  }
+
+  ///
+  ///\brief Fire this Transition if ready, locking only its places (requires the shared lock of
+  /// the net, see locksPlaces())
+  ///
+  /// Takes the locks of all places in ascending order (so firings never deadlock). The tracked
+  /// state is updated atomically (or under tracking_mutex without atomic_tracking), so firings
+  /// of disjoint places do not serialize.
+  ///
+  ///\param places_to_notify receives all changed places with a listener and their previous
+  /// token count
+  ///\return true fired
+  ///\return false not ready
+  ///
+  bool fireLockingPlacesAcquired(NotifyListT &places_to_notify) const noexcept(false) {
+    auto &state = *this->net_state_;
+
+    StripesT stripes;
+    this->placeStripes(stripes);
+
+    struct PlaceLocks {
+      NetStateT &state;
+      const StripesT &stripes;
+
+      PlaceLocks(NetStateT &state, const StripesT &stripes)
+          : state(state), stripes(stripes) {
+        for (auto stripe : stripes) {
+          state.place_locks[stripe].lock();
+        }
+      }
+      ~PlaceLocks() {
+        for (auto stripe : stripes) {
+          state.place_locks[stripe].unlock();
+        }
+      }
+    } place_locks(state, stripes);
+
+    auto &marking = state.marking;
+    for (const auto &arc : this->ingoing_) {
+      if (marking[arc.marking_pos] < arc.weight) {
+        return false;
+      }
+    }
+
+    // Change the tokens first, the tracked state afterwards in one go
+    struct Change {
+      PlaceT *place;
+      TokenCounterT prev;
+      TokenCounterT tokens;
+    };
+    SmallVector<Change, 8> changes;
+    for (const auto &arc : this->ingoing_) {
+      auto &tokens = marking[arc.marking_pos];
+      auto prev = tokens;
+      tokens = tokens - arc.weight;
+      changes.push_back({arc.place, prev, tokens});
+    }
+    for (const auto &arc : this->outgoing_) {
+      auto &tokens = marking[arc.marking_pos];
+      auto prev = tokens;
+      tokens = tokens + arc.weight;
+      changes.push_back({arc.place, prev, tokens});
+    }
+
+    if (state.atomic_tracking) {
+      for (const auto &change : changes) {
+        change.place->updateConsumersAtomic(change.prev, change.tokens);
+      }
+    } else if (state.track_changes) {
+      std::lock_guard tracking_lock(state.tracking_mutex);
+      for (const auto &change : changes) {
+        change.place->updateConsumersAcquired(change.prev, change.tokens);
+      }
+    }
+    for (const auto &change : changes) {
+      if (change.place->observed()) {
+        places_to_notify.push_back(std::make_pair(change.place, change.prev));
+      }
+    }
+    return true;
+  }
+
+  ///
+  ///\brief Fire this Transition if ready without locking its places (requires the shared lock
+  /// of the net or NetMutex::enterFast(), the net must change tokens atomically)
+  ///
+  /// The ingoing tokens are reserved arc by arc with compare-and-swap loops, if one arc is not
+  /// satisfied anymore the reserved tokens are given back. A concurrent firing may fail while
+  /// it sees tokens which are given back later.
+  ///
+  ///\param places_to_notify receives all changed places with a listener and their previous
+  /// token count
+  ///\return true fired
+  ///\return false not ready
+  ///
+  bool fireAtomicAcquired(NotifyListT &places_to_notify) const noexcept(false) {
+    if constexpr (NetStateT::k_atomic_tokens_supported) {
+      auto &marking = this->net_state_->marking;
+      for (const auto &arc : this->ingoing_) {
+        if (atomics::load(marking[arc.marking_pos]) < arc.weight) {
+          return false;
+        }
+      }
+
+      auto first = places_to_notify.size();
+      auto changed = [&](const Arc &arc, TokenCounterT prev, TokenCounterT tokens) {
+        arc.place->updateConsumersAtomic(prev, tokens);
+        if (arc.place->observed()) {
+          places_to_notify.push_back(std::make_pair(arc.place, prev));
+        }
+      };
+
+      for (std::size_t i = 0; i < this->ingoing_.size(); ++i) {
+        const auto &arc = this->ingoing_[i];
+        auto &tokens = marking[arc.marking_pos];
+        auto prev = atomics::load(tokens);
+        do {
+          if (prev < arc.weight) {
+            // Give back the reserved tokens, nothing changed in the end
+            while (places_to_notify.size() > first) {
+              places_to_notify.pop_back();
+            }
+            while (i-- > 0) {
+              const auto &reserved = this->ingoing_[i];
+              auto before = atomics::fetchAdd(marking[reserved.marking_pos], reserved.weight);
+              reserved.place->updateConsumersAtomic(before, before + reserved.weight);
+            }
+            return false;
+          }
+        } while (!atomics::compareExchange(tokens, prev, prev - arc.weight));
+        changed(arc, prev, prev - arc.weight);
+      }
+      for (const auto &arc : this->outgoing_) {
+        auto prev = atomics::fetchAdd(marking[arc.marking_pos], arc.weight);
+        changed(arc, prev, prev + arc.weight);
+      }
+      return true;
+    } else {
+      (void)places_to_notify;
+      return false;
+    }
+  }
+
+  ///
+  ///\brief Fire this Transition if ready, validating the versions of its places instead of
+  /// locking them (requires the shared lock of the net or NetMutex::enterFast(), the net must
+  /// validate versions)
+  ///
+  /// Reads the versions and the ingoing tokens without locking. If the Transition is not ready
+  /// and no version changed meanwhile, nothing is written at all. Otherwise the versions read
+  /// are locked in ascending order by compare-and-swap (failing if a firing committed in
+  /// between), the tokens are changed and the versions are released incremented. Conflicts
+  /// retry from the start.
+  ///
+  ///\param places_to_notify receives all changed places with a listener and their previous
+  /// token count
+  ///\return true fired
+  ///\return false not ready
+  ///
+  bool fireOptimisticAcquired(NotifyListT &places_to_notify) const noexcept(false) {
+    if constexpr (NetStateT::k_atomic_tokens_supported) {
+      auto &marking = this->net_state_->marking;
+      auto *versions = this->net_state_->place_versions.get();
+
+      StripesT stripes;
+      this->placeStripes(stripes);
+      SmallVector<std::uint64_t, 8> seen;
+      seen.reserve(stripes.size());
+
+      auto unchanged = [&]() {
+        for (std::size_t i = 0; i < stripes.size(); ++i) {
+          if (atomics::load(versions[stripes[i]]) != seen[i]) {
+            return false;
+          }
+        }
+        return true;
+      };
+
+      for (;;) {
+        // Read phase (an odd version is being committed, read again)
+        seen.clear();
+        bool committing = false;
+        for (auto stripe : stripes) {
+          auto version = atomics::load(versions[stripe]);
+          committing = committing || (version & 1U) != 0;
+          seen.push_back(version);
+        }
+        if (committing) {
+          continue;
+        }
+        bool rdy = true;
+        for (const auto &arc : this->ingoing_) {
+          rdy = rdy && !(atomics::load(marking[arc.marking_pos]) < arc.weight);
+        }
+        if (!rdy) {
+          if (unchanged()) {
+            return false;
+          }
+          continue;
+        }
+
+        // Validation: lock the versions read, fails if any of them changed
+        std::size_t locked = 0;
+        for (; locked < stripes.size(); ++locked) {
+          auto expected = seen[locked];
+          if (!atomics::compareExchange(versions[stripes[locked]], expected, expected + 1)) {
+            break;
+          }
+        }
+        if (locked < stripes.size()) {
+          while (locked-- > 0) {
+            atomics::store(versions[stripes[locked]], seen[locked]);
+          }
+          continue;
+        }
+
+        // Commit: the tokens can not change until the versions are released
+        auto change = [&](const Arc &arc, TokenCounterT tokens) {
+          auto &slot = marking[arc.marking_pos];
+          auto prev = atomics::load(slot);
+          atomics::store(slot, tokens);
+          arc.place->updateConsumersAtomic(prev, tokens);
+          if (arc.place->observed()) {
+            places_to_notify.push_back(std::make_pair(arc.place, prev));
+          }
+        };
+        for (const auto &arc : this->ingoing_) {
+          change(arc, atomics::load(marking[arc.marking_pos]) - arc.weight);
+        }
+        for (const auto &arc : this->outgoing_) {
+          change(arc, atomics::load(marking[arc.marking_pos]) + arc.weight);
+        }
+        for (std::size_t i = 0; i < stripes.size(); ++i) {
+          atomics::store(versions[stripes[i]], seen[i] + 2);
+        }
+        return true;
+      }
+    } else {
+      (void)places_to_notify;
+      return false;
+    }
+  }
+
+  ///
+  ///\brief Get how often this Transition can fire in a row (does not lock mutex)
+  ///
+  /// The minimum over all ingoing arcs of tokens / weight, arcs without weight are ignored.
+  /// Floating point degrees are rounded down, so the Transition fires a whole number of times.
+  ///
+  ///\return std::optional<TokenCounterT> the enabling degree, std::nullopt if unbounded
+  ///
+  std::optional<TokenCounterT> enablingDegreeAcquired() const noexcept(true) {
+    const auto &marking = this->net_state_->marking;
+    std::optional<TokenCounterT> degree;
+    for (const auto &arc : this->ingoing_) {
+      if (TokenCounterT{} < arc.weight) {
+        TokenCounterT arc_degree = marking[arc.marking_pos] / arc.weight;
+        if constexpr (std::is_floating_point_v<TokenCounterT>) {
+          arc_degree = std::floor(arc_degree);
+        }
+        if (!degree.has_value() || arc_degree < *degree) {
+          degree = arc_degree;
+        }
       }
     }
+    return degree;
+  }
+
+  ///
+  ///\brief Fire this Transition n times at once if it is ready for that (does not lock mutex)
+  ///
+  /// Compares tokens / weight with n, so weight * n can not overflow for satisfied arcs.
+  ///
+  ///\param n how often to fire
+  ///\param places_to_notify receives all changed places with a listener and their previous
+  /// token count (each place once)
+  ///\return true fired
+  ///\return false not ready to fire n times (or n is not positive)
+  ///
+  bool fireNAcquired(const TokenCounterT &n, NotifyListT &places_to_notify) const
+      noexcept(false) {
+    if (!(TokenCounterT{} < n)) {
+      return false;
+    }
+    const auto &marking = this->net_state_->marking;
+    for (const auto &arc : this->ingoing_) {
+      if (TokenCounterT{} < arc.weight && marking[arc.marking_pos] / arc.weight < n) {
+        return false;
+      }
+    }
+
+    auto first = places_to_notify.size();
+    this->applyAcquired(
+        this->ingoing_, [&](const auto &tokens, const auto &weight) { return tokens - weight * n; },
+        places_to_notify);
+    this->applyAcquired(
+        this->outgoing_,
+        [&](const auto &tokens, const auto &weight) { return tokens + weight * n; },
+        places_to_notify);
+
+    // Coalesce the notifications of places with multiple arcs (keep the first previous count)
+    auto end = first;
+    for (auto i = first; i < places_to_notify.size(); ++i) {
+      bool seen = false;
+      for (auto j = first; j < end && !seen; ++j) {
+        seen = places_to_notify[j].first == places_to_notify[i].first;
+      }
+      if (!seen) {
+        places_to_notify[end++] = places_to_notify[i];
+      }
+    }
+    while (places_to_notify.size() > end) {
+      places_to_notify.pop_back();
+    }
+    return true;
+  }
+
+  ///
+  ///\brief Queue this Transition for the next dirty tick (does not lock mutex)
+  ///
+  void invalidateAcquired() const noexcept(true) {
+    if (this->net_state_->track_changes) {
+      this->net_state_->markDirty(static_cast<std::size_t>(this->index_));
+    }
+  }
+
+  ///
+  ///\brief Notify places about a change (call in an unlocked context)
+  ///
+  ///\param places_to_notify changed places with their previous token count
+  ///
+  static void notify(const NotifyListT &places_to_notify) noexcept(true) {
+    for (const auto &[place, prev] : places_to_notify) {
+      place->changed(prev);
+    }
   }
 
 public:
@@ -110,7 +607,8 @@ public:
   ///\return false not ready
   ///
   [[nodiscard]] bool ready() const noexcept(true) {
-    std::shared_lock lock(*this->net_mutex_);
+    std::shared_lock lock(this->net_state_->mutex);
+    auto tracking_lock = this->net_state_->lockTracking();
     return this->readyAcquired();
   }
 
@@ -121,38 +619,77 @@ public:
   ///\return false not ready
   ///
   bool fire() const noexcept(true) {
-    bool rdy = false;
-
     // Memorize places, before the datastructures get unlocked again
-    std::vector<std::pair<std::shared_ptr<PlaceT>, TokenCounterT>> places_to_notify;
+    NotifyListT places_to_notify;
 
-    this->net_mutex_->lock();
+    bool rdy;
+    if (this->net_state_->validatesVersions()) {
+      FastReadLock lock(this->net_state_->mutex);
+      rdy = this->fireOptimisticAcquired(places_to_notify);
+    } else if (this->net_state_->atomic_tokens) {
+      FastReadLock lock(this->net_state_->mutex);
+      rdy = this->fireAtomicAcquired(places_to_notify);
+    } else if (this->locksPlaces()) {
+      std::shared_lock lock(this->net_state_->mutex);
+      rdy = this->fireLockingPlacesAcquired(places_to_notify);
+    } else {
+      this->net_state_->mutex.lock();
+      rdy = this->fireAcquired(places_to_notify);
+      this->net_state_->mutex.unlock();
+    }
 
-    // Fire, if ready
-    rdy = this->readyAcquired();
-    if (rdy) {
-      places_to_notify.reserve(this->ingoing_.size() + this->outgoing_.size());
+    // Notify about place changes (in an unlocked context)
+    notify(places_to_notify);
 
-      for (auto &[place, weight] : this->ingoing_) {
-        places_to_notify.push_back(std::make_pair(place, place->tokens_));
-        place->tokens_ = place->tokens_ - weight;
-      }
-      for (auto &[place, weight] : this->outgoing_) {
-        places_to_notify.push_back(std::make_pair(place, place->tokens_));
-        place->tokens_ = place->tokens_ + weight;
-      }
-    }
+    return rdy;
+  }
+
+  ///
+  ///\brief Fire this Transition n times in one go (all or nothing)
+  ///
+  /// The tokens of every place change once by n times the weight and every changed place is
+  /// notified once. Requires operator* and operator/ of TokenCounterT.
+  ///
+  ///\param n how often to fire
+  ///\return true fired n times
+  ///\return false not ready to fire n times or n is 0 (nothing changed)
+  ///
+  bool fireN(TokenCounterT n) const noexcept(true) {
+    NotifyListT places_to_notify;
 
-    this->net_mutex_->unlock();
+    this->net_state_->mutex.lock();
+    bool rdy = this->fireNAcquired(n, places_to_notify);
+    this->net_state_->mutex.unlock();
 
-    // Notify about place changes (in an unlocked context)
-    for (const auto &[place, prev] : places_to_notify) {
-      place->changed(prev);
-    }
+    notify(places_to_notify);
 
     return rdy;
   }
 
+  ///
+  ///\brief Fire this Transition as often as it is enabled in one go
+  ///
+  /// Like fireN() with the enabling degree (the minimum over all ingoing arcs of
+  /// tokens / weight). A Transition without ingoing arcs fires once. Requires operator* and
+  /// operator/ of TokenCounterT.
+  ///
+  ///\return TokenCounterT how often this Transition fired
+  ///
+  TokenCounterT fireMax() const noexcept(true) {
+    NotifyListT places_to_notify;
+
+    this->net_state_->mutex.lock();
+    auto n = this->enablingDegreeAcquired().value_or(TokenCounterT{1});
+    if (TokenCounterT{} < n) {
+      this->fireNAcquired(n, places_to_notify);
+    }
+    this->net_state_->mutex.unlock();
+
+    notify(places_to_notify);
+
+    return n;
+  }
+
   ///
   ///\brief Fire this transition, then deepTick all transitions that might
   /// have become ready.
@@ -161,9 +698,8 @@ public:
   ///
   bool deepFire() noexcept(false) {
     if (this->fire()) {
-      std::set<IDT> seen;
-      for (auto &[place, _] : this->outgoing_) {
-        place->deepTick(seen);
+      for (auto &arc : this->outgoing_) {
+        arc.place->deepTick();
       }
       return true;
     }
@@ -181,14 +717,27 @@ public:
   ///
   void autoFire(std::function<bool(const Transition<IDT, TokenCounterT> &)>
                     evaluate_condition) noexcept(true) {
+    std::lock_guard lock(this->net_state_->mutex);
     this->evaluate_condition_ = evaluate_condition;
+    this->invalidateAcquired();
   }
 
   ///
   ///\brief Auto-fire this transition on each tick
   ///
   void autoFire() {
-    this->evaluate_condition_ = [](auto &) { return true; };
+    this->autoFire([](auto &) { return true; });
+  }
+
+  ///
+  ///\brief Re-evaluate the autoFire() condition on the next PetriNet::tickDirty()
+  ///
+  /// Changes of the ingoing places queue the transition automatically, call this if the
+  /// condition depends on anything else.
+  ///
+  void invalidate() noexcept(true) {
+    std::lock_guard lock(this->net_state_->mutex);
+    this->invalidateAcquired();
   }
 
   ///
@@ -210,8 +759,29 @@ public:
   /// \throws std::runtime_error if cycles were detected
   ///
   void deepTick() noexcept(false) {
-    std::set<IDT> seen;
-    this->deepTick(seen);
+    if (this->tick()) {
+      for (auto &arc : this->outgoing_) {
+        arc.place->deepTick();
+      }
+    }
+  }
+
+  ///
+  ///\brief Set the priority used by PetriNet::tickPrioritized() (default 0)
+  ///
+  ///\param priority higher priorities tick first
+  ///
+  void setPriority(int priority) noexcept(true) {
+    std::lock_guard lock(this->net_state_->mutex);
+    this->priority_ = priority;
+  }
+
+  ///
+  ///\brief Get the priority used by PetriNet::tickPrioritized()
+  ///
+  [[nodiscard]] int getPriority() const noexcept(true) {
+    std::shared_lock lock(this->net_state_->mutex);
+    return this->priority_;
   }
 
   ///
@@ -220,6 +790,13 @@ public:
   ///\return const IDT&
   ///
   [[nodiscard]] const IDT &getID() const noexcept(true) { return this->id_; }
+
+  ///
+  ///\brief get the Transition's dense handle inside its PetriNet
+  ///
+  ///\return TransitionIndex
+  ///
+  [[nodiscard]] TransitionIndex getIndex() const noexcept(true) { return this->index_; }
 };
 
 }  // namespace sptn
@@ -0,0 +1,241 @@
+// Copyright Open Logistics Foundation
+// 
+// Licensed under the Open Logistics Foundation License 1.3.
+// For details on the licensing terms, see the LICENSE file.
+// SPDX-License-Identifier: OLFL-1.3
+// 
+// This file contains the TransitionSet class
+
+#ifndef SIMPLEPTN_INCLUDE_SIMPLEPTN_TRANSITION_SET_HPP_
+#define SIMPLEPTN_INCLUDE_SIMPLEPTN_TRANSITION_SET_HPP_
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "transition.hpp"
+
+namespace sptn {
+
+///
+///\brief Set of Transitions of one PetriNet stored as a bitset (one bit per TransitionIndex)
+///
+class TransitionSet {
+  std::size_t size_ = 0;
+  std::vector<std::uint64_t> words_;
+
+  static std::size_t popcount(std::uint64_t word) noexcept(true) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<std::size_t>(__builtin_popcountll(word));
+#else
+    std::size_t count = 0;
+    for (; word != 0; word &= word - 1) {
+      ++count;
+    }
+    return count;
+#endif
+  }
+
+  static std::size_t lowestBit(std::uint64_t word) noexcept(true) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<std::size_t>(__builtin_ctzll(word));
+#else
+    std::size_t bit = 0;
+    for (; (word & 1U) == 0; word >>= 1) {
+      ++bit;
+    }
+    return bit;
+#endif
+  }
+
+public:
+  ///
+  ///\brief Iterates the contained Transitions in ascending order
+  ///
+  class const_iterator {
+    const TransitionSet *set_;
+    std::size_t word_;
+    std::uint64_t remaining_;  // the bits of word_ not visited yet
+
+    void skipEmptyWords() noexcept(true) {
+      const auto &words = this->set_->words_;
+      while (this->remaining_ == 0 && this->word_ < words.size()) {
+        if (++this->word_ < words.size()) {
+          this->remaining_ = words[this->word_];
+        }
+      }
+    }
+
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = TransitionIndex;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const TransitionIndex *;
+    using reference = TransitionIndex;
+
+    const_iterator(const TransitionSet *set, std::size_t word) noexcept(true)
+        : set_(set),
+          word_(word),
+          remaining_(word < set->words_.size() ? set->words_[word] : 0) {
+      this->skipEmptyWords();
+    }
+
+    TransitionIndex operator*() const noexcept(true) {
+      return TransitionIndex(this->word_ * 64 + lowestBit(this->remaining_));
+    }
+
+    const_iterator &operator++() noexcept(true) {
+      this->remaining_ &= this->remaining_ - 1;
+      this->skipEmptyWords();
+      return *this;
+    }
+
+    const_iterator operator++(int) noexcept(true) {
+      auto prev = *this;
+      ++*this;
+      return prev;
+    }
+
+    bool operator==(const const_iterator &other) const noexcept(true) {
+      return this->word_ == other.word_ && this->remaining_ == other.remaining_;
+    }
+    bool operator!=(const const_iterator &other) const noexcept(true) {
+      return !(*this == other);
+    }
+  };
+
+  TransitionSet() = default;
+
+  ///
+  ///\brief Construct an empty set
+  ///
+  ///\param size the number of Transitions of the net (all indices have to be lower)
+  ///
+  explicit TransitionSet(std::size_t size) noexcept(false)
+      : size_(size), words_((size + 63) / 64, 0) {}
+
+  ///
+  ///\brief Construct a set from a bitmap (\see CompiledNet::readyMask())
+  ///
+  ///\param size the number of Transitions of the net
+  ///\param words bit t % 64 of word t / 64 is set if Transition t is contained (no bits >= size)
+  ///
+  TransitionSet(std::size_t size, std::vector<std::uint64_t> words) noexcept(true)
+      : size_(size), words_(std::move(words)) {}
+
+  ///
+  ///\brief Get the number of Transitions of the net (not the number of contained Transitions)
+  ///
+  [[nodiscard]] std::size_t size() const noexcept(true) { return this->size_; }
+
+  ///
+  ///\brief Get the number of contained Transitions
+  ///
+  [[nodiscard]] std::size_t count() const noexcept(true) {
+    std::size_t count = 0;
+    for (auto word : this->words_) {
+      count += popcount(word);
+    }
+    return count;
+  }
+
+  ///
+  ///\brief Check if no Transition is contained
+  ///
+  [[nodiscard]] bool none() const noexcept(true) {
+    for (auto word : this->words_) {
+      if (word != 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  [[nodiscard]] bool contains(TransitionIndex index) const noexcept(true) {
+    auto pos = static_cast<std::size_t>(index);
+    return pos < this->size_ && ((this->words_[pos / 64] >> (pos % 64)) & 1U) != 0;
+  }
+
+  ///
+  ///\brief Add a Transition (index has to be lower than size())
+  ///
+  void insert(TransitionIndex index) noexcept(true) {
+    auto pos = static_cast<std::size_t>(index);
+    assert(pos < this->size_);
+    this->words_[pos / 64] |= std::uint64_t{1} << (pos % 64);
+  }
+
+  ///
+  ///\brief Remove a Transition (index has to be lower than size())
+  ///
+  void erase(TransitionIndex index) noexcept(true) {
+    auto pos = static_cast<std::size_t>(index);
+    assert(pos < this->size_);
+    this->words_[pos / 64] &= ~(std::uint64_t{1} << (pos % 64));
+  }
+
+  ///
+  ///\brief Keep only the Transitions contained in both sets
+  ///
+  TransitionSet &operator&=(const TransitionSet &other) noexcept(true) {
+    for (std::size_t i = 0; i < this->words_.size(); ++i) {
+      this->words_[i] &= i < other.words_.size() ? other.words_[i] : 0;
+    }
+    return *this;
+  }
+
+  ///
+  ///\brief Add all Transitions of other
+  ///
+  /// Grows to the size of other if other belongs to a larger net (e.g. taken after adding
+  /// Transitions).
+  ///
+  TransitionSet &operator|=(const TransitionSet &other) noexcept(false) {
+    if (this->size_ < other.size_) {
+      this->size_ = other.size_;
+      this->words_.resize(other.words_.size(), 0);
+    }
+    for (std::size_t i = 0; i < other.words_.size(); ++i) {
+      this->words_[i] |= other.words_[i];
+    }
+    return *this;
+  }
+
+  ///
+  ///\brief Remove all Transitions of other
+  ///
+  /// Transitions of other beyond size() are not contained anyway, the size stays.
+  ///
+  TransitionSet &operator-=(const TransitionSet &other) noexcept(true) {
+    for (std::size_t i = 0; i < this->words_.size() && i < other.words_.size(); ++i) {
+      this->words_[i] &= ~other.words_[i];
+    }
+    return *this;
+  }
+
+  friend TransitionSet operator&(TransitionSet a, const TransitionSet &b) { return a &= b; }
+  friend TransitionSet operator|(TransitionSet a, const TransitionSet &b) { return a |= b; }
+  friend TransitionSet operator-(TransitionSet a, const TransitionSet &b) { return a -= b; }
+
+  bool operator==(const TransitionSet &other) const noexcept(true) {
+    return this->size_ == other.size_ && this->words_ == other.words_;
+  }
+  bool operator!=(const TransitionSet &other) const noexcept(true) { return !(*this == other); }
+
+  [[nodiscard]] const_iterator begin() const noexcept(true) { return {this, 0}; }
+  [[nodiscard]] const_iterator end() const noexcept(true) { return {this, this->words_.size()}; }
+
+  ///
+  ///\brief Get the bitmap (bit t % 64 of word t / 64 is set if Transition t is contained)
+  ///
+  [[nodiscard]] const std::vector<std::uint64_t> &words() const noexcept(true) {
+    return this->words_;
+  }
+};
+
+}  // namespace sptn
+
+#endif  // SIMPLEPTN_INCLUDE_SIMPLEPTN_TRANSITION_SET_HPP_
@@ -9,9 +9,12 @@
 
 #include "SimplePTN/petri_net.hpp"
 
+#include <atomic>
 #include <catch2/catch.hpp>
 #include <iostream>
 #include <map>
+#include <memory_resource>
+#include <thread>
 
 TEST_CASE("sptn::PetriNet find{Place,Transition}()"
           "[SPTN][PetriNet]") {
@@ -292,9 +295,9 @@ TEST_CASE("sptn::PetriNet deepTick()", "[sptn][PetriNet]") {
     net.addPlace("B", 1);
     net.addPlace("A", 1);
 
-    net.addTransition({"TAC", {{"A", 1}}, {{"C", 1}}})->autoFire();
-    net.addTransition({"TBD", {{"B", 1}}, {{"D", 1}}})->autoFire();
-    net.addTransition({"TCDE", {{"C", 1}, {"D", 1}}, {{"E", 1}}})->autoFire();
+    net.transition(net.addTransition({"TAC", {{"A", 1}}, {{"C", 1}}})).autoFire();
+    net.transition(net.addTransition({"TBD", {{"B", 1}}, {{"D", 1}}})).autoFire();
+    net.transition(net.addTransition({"TCDE", {{"C", 1}, {"D", 1}}, {{"E", 1}}})).autoFire();
 
     WHEN("Deep ticking from A") {
       net.deepTick("A");
@@ -352,10 +355,10 @@ TEST_CASE("sptn::PetriNet deepTick() cycle detection", "[sptn][PetriNet]") {
     net.addPlace("D", 0);
     net.addPlace("E", 0);
 
-    net.addTransition({"AB", {{"A", 1}}, {{"B", 1}}})->autoFire();
-    net.addTransition({"BC", {{"B", 1}}, {{"C", 1}}})->autoFire();
-    net.addTransition({"CD", {{"C", 1}}, {{"D", 1}}})->autoFire();
-    net.addTransition({"DEA", {{"D", 1}}, {{"E", 1}, {"A", 1}}})->autoFire();
+    net.transition(net.addTransition({"AB", {{"A", 1}}, {{"B", 1}}})).autoFire();
+    net.transition(net.addTransition({"BC", {{"B", 1}}, {{"C", 1}}})).autoFire();
+    net.transition(net.addTransition({"CD", {{"C", 1}}, {{"D", 1}}})).autoFire();
+    net.transition(net.addTransition({"DEA", {{"D", 1}}, {{"E", 1}, {"A", 1}}})).autoFire();
 
     WHEN("deepTick() is called") {
       THEN("it throws a runtime error") {
@@ -372,13 +375,1451 @@ TEST_CASE("sptn::PetriNet deepTick() cycle detection", "[sptn][PetriNet]") {
     net.addPlace("D", 0);
     net.addPlace("E", 0);
 
-    net.addTransition({"ABC", {{"A", 1}}, {{"B", 1}, {"C", 1}}})->autoFire();
-    net.addTransition({"BD", {{"B", 1}}, {{"D", 1}}})->autoFire();
-    net.addTransition({"CD", {{"C", 1}}, {{"D", 1}}})->autoFire();
-    net.addTransition({"AE", {{"A", 1}}, {{"E", 1}}})->autoFire();
+    net.transition(net.addTransition({"ABC", {{"A", 1}}, {{"B", 1}, {"C", 1}}})).autoFire();
+    net.transition(net.addTransition({"BD", {{"B", 1}}, {{"D", 1}}})).autoFire();
+    net.transition(net.addTransition({"CD", {{"C", 1}}, {{"D", 1}}})).autoFire();
+    net.transition(net.addTransition({"AE", {{"A", 1}}, {{"E", 1}}})).autoFire();
 
     WHEN("deepTick() is called") {
       THEN("it dows not trow a runtime error") { REQUIRE_NOTHROW(net.deepTick("A")); }
     }
   }
 }
+
+namespace {
+// ID type without std::hash support (uses the ordered index)
+struct OrderedID {
+  int value;
+
+  bool operator==(const OrderedID &other) const { return this->value == other.value; }
+  bool operator<(const OrderedID &other) const { return this->value < other.value; }
+};
+}  // namespace
+
+TEST_CASE("sptn::PetriNet ID index", "[SPTN][PetriNet]") {
+  GIVEN("A large petri net with string IDs") {
+    sptn::PetriNet<> net;
+    constexpr int k_places = 10000;
+    for (int i = 0; i < k_places; ++i) {
+      net.addPlace("P" + std::to_string(i), i);
+    }
+    for (int i = 1; i < k_places; ++i) {
+      auto pre = "P" + std::to_string(i - 1);
+      auto post = "P" + std::to_string(i);
+      net.addTransition({"T" + std::to_string(i), {{pre, 1}}, {{post, 1}}});
+    }
+
+    THEN("all nodes can be found") {
+      REQUIRE(net.findPlace("P0")->getTokens() == 0);
+      REQUIRE(net.findPlace("P9999")->getTokens() == 9999);
+      REQUIRE(net.findTransition("T1")->getID() == "T1");
+      REQUIRE(net.findTransition("T9999")->getID() == "T9999");
+      REQUIRE(net.findTransition("T0") == nullptr);
+    }
+    THEN("duplicates are rejected") {
+      REQUIRE_THROWS_AS(net.addPlace("P42", 0), std::invalid_argument);
+      REQUIRE_THROWS_AS(net.addTransition({"T42", {}, {}}), std::invalid_argument);
+    }
+  }
+
+  GIVEN("A petri net with an ID type that is not hashable") {
+    sptn::PetriNet<OrderedID, uint32_t> net;
+    net.addPlace({1}, 1);
+    net.addPlace({2}, 0);
+    net.addTransition({{3}, {{{1}, 1}}, {{{2}, 1}}});
+
+    THEN("nodes can be found and fired") {
+      REQUIRE(net.findPlace({1}) != nullptr);
+      REQUIRE(net.findPlace({3}) == nullptr);
+      REQUIRE(net.findTransition({3})->fire());
+      REQUIRE(net.findPlace({2})->getTokens() == 1);
+      REQUIRE_THROWS_AS(net.addPlace({2}, 0), std::invalid_argument);
+    }
+  }
+}
+
+TEST_CASE("sptn::PetriNet handles", "[SPTN][PetriNet]") {
+  GIVEN("A petri net built from handles") {
+    sptn::PetriNet<> net;
+    auto a = net.addPlace("A", 2);
+    auto b = net.addPlace("B", 0);
+    auto t = net.addTransition({"T", {{"A", 2}}, {{"B", 1}}});
+
+    THEN("handles are dense and match the nodes") {
+      REQUIRE(static_cast<std::size_t>(a) == 0);
+      REQUIRE(static_cast<std::size_t>(b) == 1);
+      REQUIRE(static_cast<std::size_t>(t) == 0);
+      REQUIRE(net.findPlace("B")->getIndex() == b);
+      REQUIRE(net.findTransition("T")->getIndex() == t);
+      REQUIRE(net.place(a).getID() == "A");
+      REQUIRE(net.transition(t).getID() == "T");
+    }
+
+    WHEN("the transition is fired by its handle") {
+      REQUIRE(net.ready(t));
+      REQUIRE(net.fire(t));
+
+      THEN("the tokens are moved") {
+        REQUIRE(net.tokens(a) == 0);
+        REQUIRE(net.tokens(b) == 1);
+        REQUIRE_FALSE(net.ready(t));
+        REQUIRE_FALSE(net.fire(t));
+      }
+    }
+  }
+
+  GIVEN("Two merged petri nets") {
+    sptn::PetriNet<> net1;
+    sptn::PetriNet<> net2;
+    net1.addPlace("A", 1);
+    net2.addPlace("B", 2);
+    net1.merge(std::move(net2), {});
+
+    THEN("the merged places get new handles") {
+      auto b = net1.findPlace("B")->getIndex();
+      REQUIRE(static_cast<std::size_t>(b) == 1);
+      REQUIRE(net1.tokens(b) == 2);
+    }
+  }
+}
+
+TEST_CASE("sptn::PetriNet heterogeneous lookup", "[SPTN][PetriNet]") {
+  GIVEN("A petri net with string IDs longer than the SSO buffer") {
+    sptn::PetriNet<> net;
+    net.addPlace("supplier_stock_28@2_with_a_long_name", 4);
+    net.addPlace("freight", 0);
+
+    using namespace std::string_view_literals;
+    sptn::PetriNet<>::BasicTransitionSketch<std::string_view> supply{
+        "supply_28@2", {{"supplier_stock_28@2_with_a_long_name"sv, 2}}, {{"freight"sv, 2}}};
+    auto t = net.addTransition(supply);
+
+    THEN("nodes can be found by string_view and character arrays") {
+      REQUIRE(net.findPlace("supplier_stock_28@2_with_a_long_name"sv) != nullptr);
+      REQUIRE(net.findPlace("freight") != nullptr);
+      REQUIRE(net.findPlace("missing"sv) == nullptr);
+      REQUIRE(net.findTransition("supply_28@2"sv)->getIndex() == t);
+    }
+
+    THEN("string_view sketches with unknown places are rejected") {
+      sptn::PetriNet<>::BasicTransitionSketch<std::string_view> invalid{
+          "invalid", {{"missing"sv, 1}}, {}};
+      REQUIRE_THROWS_AS(net.addTransition(invalid), std::invalid_argument);
+    }
+
+    WHEN("deep ticking by string_view") {
+      net.findTransition("supply_28@2"sv)->autoFire();
+      net.deepTick("supplier_stock_28@2_with_a_long_name"sv);
+
+      THEN("the transition fired") { REQUIRE(net.findPlace("freight"sv)->getTokens() == 2); }
+    }
+  }
+}
+
+TEST_CASE("sptn::PetriNet marking()", "[SPTN][PetriNet]") {
+  GIVEN("A petri net with a few places") {
+    sptn::PetriNet<> net;
+    net.addPlace("A", 3);
+    net.addPlace("B", 1);
+    net.addPlace("C", 0);
+    auto t = net.addTransition({"T", {{"A", 1}, {"B", 1}}, {{"C", 2}}});
+
+    WHEN("a transition fires") {
+      net.fire(t);
+
+      THEN("the snapshot is indexed by PlaceIndex") {
+        REQUIRE(net.marking() == std::vector<uint32_t>{2, 0, 2});
+        REQUIRE(net.findPlace("C")->getTokens() == 2);
+      }
+    }
+  }
+}
+
+TEST_CASE("sptn::PetriNet compile()", "[SPTN][PetriNet]") {
+  GIVEN("A compiled petri net") {
+    sptn::PetriNet<> net;
+    net.addPlace("A", 1);
+    net.addPlace("B", 1);
+    net.addPlace("C", 0);
+    net.addPlace("D", 0);
+    net.addPlace("E", 0);
+
+    net.transition(net.addTransition({"TAC", {{"A", 1}}, {{"C", 1}}})).autoFire();
+    net.transition(net.addTransition({"TBD", {{"B", 1}}, {{"D", 1}}})).autoFire();
+    auto tcde = net.addTransition({"TCDE", {{"C", 1}, {"D", 1}}, {{"E", 2}}});
+    net.transition(tcde).autoFire();
+
+    REQUIRE_FALSE(net.isCompiled());
+    REQUIRE(net.compile());
+    REQUIRE(net.isCompiled());
+
+    THEN("the incidences are stored in CSR format") {
+      auto compiled = net.compiledNet();
+      REQUIRE(compiled->transitionCount() == 3);
+      REQUIRE(compiled->placeCount() == 5);
+      REQUIRE(compiled->pre().offsets == std::vector<uint32_t>{0, 1, 2, 4});
+      REQUIRE(compiled->pre().places == std::vector<uint32_t>{0, 1, 2, 3});
+      REQUIRE(compiled->post().places == std::vector<uint32_t>{2, 3, 4});
+      REQUIRE(compiled->post().weights == std::vector<uint32_t>{1, 1, 2});
+
+      auto [begin, end] = compiled->consumers(2);
+      REQUIRE(end - begin == 1);
+      REQUIRE(*begin == 2);
+    }
+
+    WHEN("Deep ticking from A and B") {
+      net.deepTick("A");
+      net.deepTick("B");
+
+      THEN("A=0,B=0,C=0,D=0,E=2") {
+        REQUIRE(net.marking() == std::vector<uint32_t>{0, 0, 0, 0, 2});
+        REQUIRE_FALSE(net.ready(tcde));
+      }
+    }
+
+    WHEN("Deep ticking every place") {
+      net.deepTickCover();
+
+      THEN("A=0,B=0,C=0,D=0,E=2") {
+        REQUIRE(net.marking() == std::vector<uint32_t>{0, 0, 0, 0, 2});
+      }
+    }
+
+    WHEN("Ticking in topological order") {
+      net.tickTopological();
+
+      THEN("the transitions were ticked in topological order") {
+        REQUIRE(net.isAcyclic());
+        REQUIRE(net.compiledNet()->topologicalOrder() == std::vector<uint32_t>{0, 1, 2});
+        REQUIRE(net.marking() == std::vector<uint32_t>{0, 0, 0, 0, 2});
+      }
+    }
+
+    WHEN("Ticking") {
+      net.tick();
+
+      THEN("every transition was ticked once in order") {
+        REQUIRE(net.marking() == std::vector<uint32_t>{0, 0, 0, 0, 2});
+      }
+    }
+
+    WHEN("a place is added") {
+      net.addPlace("F", 0);
+
+      THEN("the compiled net is discarded") { REQUIRE_FALSE(net.isCompiled()); }
+    }
+  }
+
+  GIVEN("A compiled petri net with a cycle") {
+    sptn::PetriNet<> net;
+    net.addPlace("A", 1);
+    net.addPlace("B", 0);
+    net.transition(net.addTransition({"AB", {{"A", 1}}, {{"B", 1}}})).autoFire();
+    net.transition(net.addTransition({"BA", {{"B", 1}}, {{"A", 1}}})).autoFire();
+    REQUIRE_FALSE(net.compile());
+
+    THEN("deepTick() throws a runtime error") {
+      REQUIRE_THROWS_AS(net.deepTick("A"), std::runtime_error);
+    }
+
+    THEN("deepTickCover() throws a runtime error") {
+      REQUIRE_THROWS_AS(net.deepTickCover(), std::runtime_error);
+    }
+
+    THEN("the cycle is known before tickTopological() ticks anything") {
+      REQUIRE_FALSE(net.isAcyclic());
+      REQUIRE_THROWS_AS(net.tickTopological(), std::runtime_error);
+      REQUIRE(net.marking() == std::vector<uint32_t>{1, 0});
+    }
+  }
+
+  GIVEN("A compiled petri net whose transitions were added against the flow") {
+    sptn::PetriNet<> net;
+    net.addPlace("A", 1);
+    net.addPlace("B", 0);
+    net.addPlace("C", 0);
+    net.transition(net.addTransition({"BC", {{"B", 1}}, {{"C", 1}}})).autoFire();
+    net.transition(net.addTransition({"AB", {{"A", 1}}, {{"B", 1}}})).autoFire();
+    net.compile();
+
+    WHEN("Ticking in topological order") {
+      net.tickTopological();
+
+      THEN("the token passes the whole net in one sweep") {
+        REQUIRE(net.compiledNet()->topologicalOrder() == std::vector<uint32_t>{1, 0});
+        REQUIRE(net.marking() == std::vector<uint32_t>{0, 0, 1});
+      }
+    }
+  }
+
+  GIVEN("Two equal petri nets with a fan-in, one of them compiled") {
+    auto build = [](sptn::PetriNet<> &net) {
+      net.addPlace("P1", 1);
+      net.addPlace("P2", 1);
+      net.addPlace("Q", 0);
+      net.addPlace("R", 0);
+      net.addPlace("S", 0);
+      net.transition(net.addTransition({"T1", {{"P1", 1}}, {{"Q", 1}}})).autoFire();
+      net.transition(net.addTransition({"T2", {{"P2", 1}}, {{"Q", 1}}})).autoFire();
+      net.transition(net.addTransition({"T3", {{"Q", 1}}, {{"R", 1}}})).autoFire();
+      // a source is never reached from a place
+      net.transition(net.addTransition({"TS", {}, {{"S", 1}}})).autoFire();
+    };
+    sptn::PetriNet<> net;
+    sptn::PetriNet<> compiled_net;
+    build(net);
+    build(compiled_net);
+    compiled_net.compile();
+
+    WHEN("Deep ticking every place of both") {
+      net.deepTickCover();
+      compiled_net.deepTickCover();
+
+      THEN("the markings are equal") {
+        REQUIRE(net.marking() == std::vector<uint32_t>{0, 0, 0, 2, 0});
+        REQUIRE(compiled_net.marking() == net.marking());
+      }
+    }
+
+    WHEN("Ticking the compiled net in topological order") {
+      compiled_net.tickTopological();
+
+      THEN("the joined transition fired for both tokens and the source did not fire") {
+        REQUIRE(compiled_net.marking() == std::vector<uint32_t>{0, 0, 0, 2, 0});
+      }
+    }
+  }
+
+  GIVEN("Two equal petri nets with a self-loop, one of them compiled") {
+    auto build = [](sptn::PetriNet<> &net) {
+      net.addPlace("A", 1);
+      net.addPlace("Tool", 1);
+      net.addPlace("B", 0);
+      net.transition(net.addTransition({"Work", {{"A", 1}, {"Tool", 1}}, {{"B", 1}, {"Tool", 1}}}))
+          .autoFire();
+    };
+    sptn::PetriNet<> net;
+    sptn::PetriNet<> compiled_net;
+    build(net);
+    build(compiled_net);
+    compiled_net.compile();
+
+    WHEN("Deep ticking every place of both") {
+      net.deepTickCover();
+      compiled_net.deepTickCover();
+
+      THEN("the loop that can not fire twice is no error") {
+        REQUIRE(net.marking() == std::vector<uint32_t>{0, 1, 1});
+        REQUIRE(compiled_net.marking() == net.marking());
+      }
+    }
+  }
+
+  GIVEN("Two equal chains with a token on every place, one of them compiled") {
+    auto build = [](sptn::PetriNet<int> &net, int length, std::size_t &calls) {
+      std::vector<std::pair<int, uint32_t>> places;
+      std::vector<sptn::PetriNet<int>::TransitionSketch> sketches;
+      for (int i = 0; i <= length; ++i) {
+        places.push_back({i, 1});
+      }
+      for (int i = 0; i < length; ++i) {
+        sketches.push_back({i, {{i, 1}}, {{i + 1, 1}}});
+      }
+      net.addPlaces(std::move(places));
+      auto first = net.addTransitions(std::move(sketches));
+      for (int i = 0; i < length; ++i) {
+        net.transition(sptn::TransitionIndex(static_cast<std::size_t>(first) + i))
+            .autoFire([&calls](const auto &) {
+              ++calls;
+              return true;
+            });
+      }
+    };
+
+    WHEN("Deep ticking every place of a short chain") {
+      constexpr int k_length = 50;
+      std::size_t calls = 0;
+      sptn::PetriNet<int> net;
+      sptn::PetriNet<int> compiled_net;
+      build(net, k_length, calls);
+      build(compiled_net, k_length, calls);
+      REQUIRE(compiled_net.compile());
+      net.deepTickCover();
+      compiled_net.deepTickCover();
+
+      THEN("the markings are equal") {
+        REQUIRE(net.tokens(sptn::PlaceIndex{k_length}) == k_length + 1);
+        REQUIRE(compiled_net.marking() == net.marking());
+      }
+    }
+
+    WHEN("Deep ticking every place of a long compiled chain") {
+      // The deep ticks fire every token along the rest of the chain, length^2 / 2 firings
+      constexpr int k_length = 20000;
+      std::size_t calls = 0;
+      sptn::PetriNet<int> net;
+      build(net, k_length, calls);
+      REQUIRE(net.compile());
+      net.deepTickCover();
+
+      THEN("every transition is ticked once") {
+        REQUIRE(calls == k_length);
+        REQUIRE(net.tokens(sptn::PlaceIndex{0}) == 0);
+        REQUIRE(net.tokens(sptn::PlaceIndex{k_length}) == k_length + 1);
+      }
+    }
+  }
+
+  GIVEN("Two equal petri nets with a probe transition, one of them compiled") {
+    auto build = [](sptn::PetriNet<> &net) {
+      net.addPlace("flag", 1);
+      net.addPlace("in", 1);
+      net.addPlace("seen", 0);
+      net.transition(net.addTransition({"move", {{"in", 1}}, {{"flag", 1}}})).autoFire();
+      net.transition(net.addTransition({"probe", {{"flag", 0}}, {{"seen", 1}}})).autoFire();
+    };
+    sptn::PetriNet<> net;
+    sptn::PetriNet<> compiled_net;
+    build(net);
+    build(compiled_net);
+    REQUIRE(compiled_net.compile());
+
+    WHEN("Deep ticking every place of both") {
+      net.deepTickCover();
+      compiled_net.deepTickCover();
+
+      THEN("the probe fires once per tick") {
+        REQUIRE(net.marking() == std::vector<uint32_t>{2, 0, 2});
+        REQUIRE(compiled_net.marking() == net.marking());
+      }
+    }
+
+    WHEN("Ticking the compiled net in topological order") {
+      compiled_net.tickTopological();
+
+      THEN("the probe fires once") {
+        REQUIRE(compiled_net.marking() == std::vector<uint32_t>{2, 0, 1});
+      }
+    }
+  }
+}
+
+TEST_CASE("sptn::PetriNet node lifetime", "[SPTN][PetriNet]") {
+  GIVEN("A connected petri net which is destroyed") {
+    std::weak_ptr<sptn::PetriNet<>::PlaceT> weak_place;
+    std::weak_ptr<sptn::PetriNet<>::TransitionT> weak_transition;
+    std::shared_ptr<sptn::PetriNet<>::PlaceT> kept_place;
+    {
+      sptn::PetriNet<> net;
+      net.addPlace("A", 1);
+      net.addPlace("B", 0);
+      net.addTransition({"AB", {{"A", 1}}, {{"B", 1}}});
+      net.addTransition({"BA", {{"B", 1}}, {{"A", 1}}});
+
+      weak_place = net.findPlace("A");
+      weak_transition = net.findTransition("AB");
+      kept_place = net.findPlace("B");
+      net.findTransition("AB")->fire();
+    }
+
+    THEN("nodes stay valid while a pointer is held") {
+      REQUIRE_FALSE(weak_place.expired());
+      REQUIRE(kept_place->getTokens() == 1);
+    }
+
+    WHEN("the last pointer is released") {
+      kept_place.reset();
+
+      THEN("all nodes are released") {
+        REQUIRE(weak_place.expired());
+        REQUIRE(weak_transition.expired());
+      }
+    }
+  }
+}
+
+namespace {
+class CountingResource : public std::pmr::memory_resource {
+public:
+  std::size_t allocated = 0;
+  std::size_t deallocated = 0;
+
+private:
+  void *do_allocate(std::size_t bytes, std::size_t alignment) override {
+    allocated += bytes;
+    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+  }
+  void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override {
+    deallocated += bytes;
+    std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+  }
+  bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+    return this == &other;
+  }
+};
+}  // namespace
+
+TEST_CASE("sptn::PetriNet memory resource", "[SPTN][PetriNet]") {
+  GIVEN("A petri net using a custom memory resource") {
+    CountingResource resource;
+    {
+      sptn::PetriNet<> net(&resource);
+      net.addPlace("A", 2);
+      net.addPlace("B", 0);
+      auto ab = net.addTransition({"AB", {{"A", 1}}, {{"B", 1}}});
+
+      THEN("the nodes are allocated from the resource") {
+        REQUIRE(resource.allocated > 0);
+        REQUIRE(resource.deallocated == 0);
+        REQUIRE(net.fire(ab));
+        REQUIRE(net.findPlace("B")->getTokens() == 1);
+      }
+
+      WHEN("another net is merged into it") {
+        sptn::PetriNet<> other(&resource);
+        other.addPlace("C", 1);
+        other.addPlace("D", 0);
+        other.addTransition({"CD", {{"C", 1}}, {{"D", 1}}});
+        net.merge(std::move(other), {{"DA", {{"D", 1}}, {{"A", 1}}}});
+
+        THEN("the merged nodes work inside the net") {
+          REQUIRE(net.findTransition("CD")->fire());
+          REQUIRE(net.findTransition("DA")->fire());
+          REQUIRE(net.findPlace("A")->getTokens() == 3);
+          REQUIRE(other.findPlace("C") == nullptr);
+        }
+      }
+    }
+
+    THEN("all memory is released with the net") {
+      REQUIRE(resource.allocated == resource.deallocated);
+    }
+  }
+}
+
+TEST_CASE("sptn::PetriNet bulk construction", "[SPTN][PetriNet]") {
+  GIVEN("A petri net with one place") {
+    sptn::PetriNet<> net;
+    net.addPlace("A", 1);
+
+    WHEN("adding places and transitions in bulk") {
+      std::vector<std::pair<std::string, uint32_t>> places = {{"B", 0}, {"C", 2}};
+      auto first_place = net.addPlaces(std::move(places));
+      std::vector<sptn::PetriNet<>::TransitionSketch> sketches = {
+          {"AB", {{"A", 1}}, {{"B", 1}}}, {"BC", {{"B", 1}}, {{"C", 1}}}};
+      auto first_transition = net.addTransitions(sketches);
+
+      THEN("the nodes get consecutive handles") {
+        REQUIRE(first_place == sptn::PlaceIndex{1});
+        REQUIRE(first_transition == sptn::TransitionIndex{0});
+        REQUIRE(net.tokens(sptn::PlaceIndex{2}) == 2);
+        REQUIRE(net.transition(sptn::TransitionIndex{1}).getID() == "BC");
+      }
+
+      THEN("the transitions are connected") {
+        REQUIRE(net.fire(first_transition));
+        REQUIRE(net.fire(sptn::TransitionIndex{1}));
+        REQUIRE(net.findPlace("C")->getTokens() == 3);
+      }
+    }
+
+    WHEN("a batch contains a duplicate ID") {
+      std::vector<std::pair<std::string, uint32_t>> places = {{"B", 0}, {"B", 1}};
+      std::vector<sptn::PetriNet<>::TransitionSketch> sketches = {{"T1", {}, {}},
+                                                                  {"T1", {}, {}}};
+
+      THEN("nothing is added") {
+        REQUIRE_THROWS_AS(net.addPlaces(places), std::invalid_argument);
+        REQUIRE_THROWS_AS(net.addTransitions(sketches), std::invalid_argument);
+        REQUIRE(net.findPlace("B") == nullptr);
+        REQUIRE(net.findTransition("T1") == nullptr);
+        REQUIRE(net.marking().size() == 1);
+      }
+    }
+
+    WHEN("a batch references an unknown place") {
+      std::vector<sptn::PetriNet<>::TransitionSketch> sketches = {{"T1", {{"A", 1}}, {}},
+                                                                  {"T2", {{"X", 1}}, {}}};
+
+      THEN("nothing is added") {
+        REQUIRE_THROWS_AS(net.addTransitions(sketches), std::invalid_argument);
+        REQUIRE(net.findTransition("T1") == nullptr);
+        REQUIRE(net.addTransition({"T1", {{"A", 1}}, {}}) == sptn::TransitionIndex{0});
+      }
+    }
+  }
+}
+
+TEST_CASE("sptn::PetriNet enabled()", "[SPTN][PetriNet]") {
+  GIVEN("A petri net with a resource loop") {
+    sptn::PetriNet<> net;
+    net.addPlace("free", 1);
+    net.addPlace("busy", 0);
+    net.addPlace("jobs", 2);
+    net.addPlace("done", 0);
+    auto start = net.addTransition({"start", {{"free", 1}, {"jobs", 1}}, {{"busy", 1}}});
+    auto stop = net.addTransition({"stop", {{"busy", 1}}, {{"free", 1}, {"done", 1}}});
+    auto batch = net.addTransition({"batch", {{"done", 1}, {"done", 2}}, {}});
+
+    auto check = [&]() {
+      THEN("enabled() and ready() match the marking") {
+        auto marking = net.marking();
+        std::vector<sptn::TransitionIndex> expected;
+        if (marking[0] >= 1 && marking[2] >= 1) {
+          expected.push_back(start);
+        }
+        if (marking[1] >= 1) {
+          expected.push_back(stop);
+        }
+        if (marking[3] >= 2) {
+          expected.push_back(batch);
+        }
+        REQUIRE(net.enabled() == expected);
+        for (auto t : {start, stop, batch}) {
+          bool is_enabled = std::find(cbegin(expected), cend(expected), t) != cend(expected);
+          REQUIRE(net.ready(t) == is_enabled);
+          REQUIRE(net.transition(t).ready() == is_enabled);
+        }
+      }
+    };
+
+    WHEN("nothing fired") { check(); }
+
+    WHEN("firing through the loop") {
+      REQUIRE(net.fire(start));
+      REQUIRE_FALSE(net.fire(start));
+      REQUIRE(net.transition(stop).fire());
+      check();
+    }
+
+    WHEN("firing the compiled net until all jobs are done") {
+      net.compile();
+      for (int i = 0; i < 2; ++i) {
+        REQUIRE(net.fire(start));
+        REQUIRE(net.fire(stop));
+      }
+      REQUIRE(net.enabled() == std::vector<sptn::TransitionIndex>{batch});
+      REQUIRE(net.fire(batch));
+      check();
+    }
+  }
+}
+
+TEST_CASE("sptn::PetriNet tickDirty()", "[SPTN][PetriNet]") {
+  GIVEN("A pipeline with counting conditions") {
+    sptn::PetriNet<> net;
+    net.addPlace("A", 1);
+    net.addPlace("B", 0);
+    net.addPlace("C", 0);
+    net.addPlace("D", 0);
+    auto ab = net.addTransition({"AB", {{"A", 1}}, {{"B", 1}}});
+    auto bc = net.addTransition({"BC", {{"B", 1}}, {{"C", 1}}});
+    auto cd = net.addTransition({"CD", {{"C", 1}}, {{"D", 1}}});
+
+    std::map<std::string, int> evaluations;
+    bool allow = true;
+    for (auto t : {ab, bc, cd}) {
+      net.transition(t).autoFire([&](const auto &transition) {
+        ++evaluations[transition.getID()];
+        return allow;
+      });
+    }
+
+    WHEN("ticking the dirty transitions") {
+      net.tickDirty();
+
+      THEN("all new transitions were ticked once in order") {
+        REQUIRE(evaluations == std::map<std::string, int>{{"AB", 1}, {"BC", 1}, {"CD", 1}});
+        REQUIRE(net.tokens(sptn::PlaceIndex{3}) == 1);
+      }
+
+      AND_WHEN("ticking until nothing changes") {
+        net.tickDirty();
+        net.tickDirty();
+
+        THEN("only the consumers of changed places were evaluated again") {
+          REQUIRE(evaluations == std::map<std::string, int>{{"AB", 2}, {"BC", 2}, {"CD", 2}});
+        }
+      }
+    }
+
+    WHEN("a condition is false") {
+      allow = false;
+      net.tickDirty();
+      net.tickDirty();
+      allow = true;
+
+      THEN("it is only evaluated again after invalidate()") {
+        REQUIRE(evaluations["AB"] == 1);
+        net.tickDirty();
+        REQUIRE(evaluations["AB"] == 1);
+        net.invalidate(ab);
+        net.tickDirty();
+        REQUIRE(evaluations["AB"] == 2);
+        REQUIRE(net.tokens(sptn::PlaceIndex{1}) == 1);
+      }
+    }
+
+    WHEN("firing actively while nothing is queued") {
+      for (int i = 0; i < 4; ++i) {
+        net.tickDirty();
+      }
+      REQUIRE(net.tokens(sptn::PlaceIndex{3}) == 1);
+      net.addPlace("E", 0);
+      net.addTransition({"E_", {{"E", 1}}, {}});
+      evaluations.clear();
+      net.tickDirty();
+      REQUIRE(evaluations.empty());
+
+      allow = false;
+      net.transition(ab).autoFire([&](const auto &) { return false; });
+      REQUIRE(net.fire(cd) == false);
+      net.addPlace("F", 1);
+      net.addTransition({"FC", {{"F", 1}}, {{"C", 1}}});
+      REQUIRE(net.fire(sptn::TransitionIndex{4}));
+      net.tickDirty();
+
+      THEN("the consumers of the changed places are evaluated") {
+        REQUIRE(evaluations == std::map<std::string, int>{{"CD", 1}});
+        REQUIRE(net.tokens(sptn::PlaceIndex{2}) == 1);
+      }
+    }
+  }
+
+  GIVEN("A condition calling tickDirty() itself") {
+    sptn::PetriNet<> net;
+    for (int i = 0; i < 4; ++i) {
+      auto id = std::to_string(i);
+      net.addPlace("in_" + id, 1);
+      net.addPlace("out_" + id, 0);
+      net.transition(net.addTransition({"T" + id, {{"in_" + id, 1}}, {{"out_" + id, 1}}}))
+          .autoFire();
+    }
+    bool nested = false;
+    net.transition(sptn::TransitionIndex{0}).autoFire([&](const auto &) {
+      if (!nested) {
+        nested = true;
+        net.tickDirty();
+      }
+      return true;
+    });
+
+    WHEN("ticking the dirty transitions") {
+      net.tickDirty();
+
+      THEN("the nested call does not disturb the outer one") {
+        REQUIRE(net.marking() == std::vector<uint32_t>{0, 1, 0, 1, 0, 1, 0, 1});
+      }
+    }
+  }
+
+  GIVEN("A transition ticked from two threads") {
+    constexpr uint32_t k_tokens = 20000;
+    sptn::PetriNet<> net;
+    auto src = net.addPlace("src", k_tokens);
+    auto dst = net.addPlace("dst", 0);
+    net.transition(net.addTransition({"move", {{"src", 1}}, {{"dst", 1}}})).autoFire();
+
+    WHEN("both threads tick the dirty transitions until all tokens moved") {
+      std::atomic<int> waiting = 2;
+      auto run = [&]() {
+        --waiting;
+        while (waiting.load() != 0) {
+        }
+        while (net.tokens(dst) != k_tokens) {
+          net.tickDirty();
+        }
+      };
+      std::thread other(run);
+      run();
+      other.join();
+
+      THEN("every token moved once") {
+        REQUIRE(net.tokens(src) == 0);
+        REQUIRE(net.tokens(dst) == k_tokens);
+      }
+    }
+  }
+}
+
+TEST_CASE("sptn::PetriNet fireStep()", "[SPTN][PetriNet]") {
+  GIVEN("Two transitions sharing an input place and a source") {
+    sptn::PetriNet<> net;
+    net.addPlace("freight", 4);
+    net.addPlace("ship_a", 0);
+    net.addPlace("ship_b", 0);
+    auto load_a = net.addTransition({"load_a", {{"freight", 1}}, {{"ship_a", 1}}});
+    auto load_b = net.addTransition({"load_b", {{"freight", 2}}, {{"ship_b", 1}}});
+    auto unload = net.addTransition({"unload", {{"ship_a", 1}}, {{"freight", 1}}});
+    auto produce = net.addTransition({"produce", {}, {{"freight", 1}}});
+
+    std::vector<uint32_t> changes;
+    net.place(sptn::PlaceIndex{0}).onChange(
+        [&](const auto &, uint32_t prev) { changes.push_back(prev); });
+
+    auto check = [&](bool compiled) {
+      if (compiled) {
+        net.compile();
+      }
+
+      WHEN("firing a step") {
+        auto fired = net.fireStep({load_a, unload, load_b, load_a});
+
+        THEN("conflicting and not ready transitions are skipped") {
+          REQUIRE(fired == std::vector<sptn::TransitionIndex>{load_a, load_b, load_a});
+          REQUIRE(net.marking() == std::vector<uint32_t>{0, 2, 1});
+          REQUIRE(changes == std::vector<uint32_t>{4, 3, 1});
+        }
+      }
+
+      WHEN("firing a maximal step") {
+        auto fired = net.fireMaximalStep();
+
+        THEN("all transitions fire in rounds without using produced tokens") {
+          REQUIRE(fired ==
+                  std::vector<sptn::TransitionIndex>{load_a, load_b, produce, load_a});
+          REQUIRE(net.marking() == std::vector<uint32_t>{1, 2, 1});
+          REQUIRE(net.enabled() == std::vector<sptn::TransitionIndex>{load_a, unload, produce});
+        }
+      }
+    };
+
+    WHEN("not compiled") { check(false); }
+    WHEN("compiled") { check(true); }
+  }
+
+  GIVEN("A probe transition with only an arc without weight") {
+    sptn::PetriNet<> net;
+    net.addPlace("flag", 1);
+    net.addPlace("seen", 0);
+    auto probe = net.addTransition({"probe", {{"flag", 0}}, {{"seen", 1}}});
+
+    WHEN("firing a maximal step") {
+      auto fired = net.fireMaximalStep();
+
+      THEN("it fires once like a source") {
+        REQUIRE(fired == std::vector<sptn::TransitionIndex>{probe});
+        REQUIRE(net.marking() == std::vector<uint32_t>{1, 1});
+      }
+    }
+  }
+}
+
+TEST_CASE("sptn::PetriNet propagate()", "[SPTN][PetriNet]") {
+  GIVEN("A net with a resource loop") {
+    sptn::PetriNet<> net;
+    net.addPlace("port_a_free", 1);
+    net.addPlace("port_a", 0);
+    net.addPlace("jobs", 3);
+    net.addPlace("done", 0);
+    net.addPlace("shuttle", 1);
+    net.addPlace("shuttle_away", 0);
+    auto enter = net.addTransition({"enter", {{"port_a_free", 1}, {"jobs", 1}}, {{"port_a", 1}}});
+    auto leave = net.addTransition({"leave", {{"port_a", 1}}, {{"port_a_free", 1}, {"done", 1}}});
+    auto go = net.addTransition({"go", {{"shuttle", 1}}, {{"shuttle_away", 1}}});
+    auto back = net.addTransition({"back", {{"shuttle_away", 1}}, {{"shuttle", 1}}});
+    for (auto t : {enter, leave}) {
+      net.transition(t).autoFire();
+    }
+
+    WHEN("propagating until quiescence") {
+      REQUIRE(net.propagate() == 6);
+
+      THEN("all jobs went through the loop") {
+        REQUIRE(net.marking() == std::vector<uint32_t>{1, 0, 0, 3, 1, 0});
+        REQUIRE(net.propagate() == 0);
+      }
+    }
+
+    WHEN("the budget is exhausted") {
+      REQUIRE(net.propagate(4) == 4);
+
+      THEN("the next call continues") {
+        REQUIRE(net.tokens(sptn::PlaceIndex{3}) == 2);
+        REQUIRE(net.propagate() == 2);
+        REQUIRE(net.tokens(sptn::PlaceIndex{3}) == 3);
+      }
+    }
+
+    WHEN("a loop never becomes quiescent") {
+      net.transition(go).autoFire();
+      net.transition(back).autoFire();
+
+      THEN("the budget ends the propagation") {
+        REQUIRE(net.propagate(101) == 101);
+        REQUIRE(net.tokens(sptn::PlaceIndex{5}) == 1);
+      }
+    }
+  }
+}
+
+TEST_CASE("sptn::PetriNet deepTick() on long chains", "[SPTN][PetriNet]") {
+  GIVEN("A pipeline deeper than the call stack could recurse") {
+    constexpr int k_length = 200000;
+    sptn::PetriNet<int> net;
+    std::vector<std::pair<int, uint32_t>> places;
+    std::vector<sptn::PetriNet<int>::TransitionSketch> sketches;
+    for (int i = 0; i <= k_length; ++i) {
+      places.push_back({i, i == 0 ? 1 : 0});
+    }
+    for (int i = 0; i < k_length; ++i) {
+      sketches.push_back({i, {{i, 1}}, {{i + 1, 1}}});
+    }
+    net.addPlaces(std::move(places));
+    auto first = net.addTransitions(std::move(sketches));
+    for (int i = 0; i < k_length; ++i) {
+      net.transition(sptn::TransitionIndex(static_cast<std::size_t>(first) + i)).autoFire();
+    }
+
+    auto check = [&]() {
+      THEN("the token reaches the end") {
+        REQUIRE(net.tokens(sptn::PlaceIndex{0}) == 0);
+        REQUIRE(net.tokens(sptn::PlaceIndex{k_length}) == 1);
+      }
+    };
+
+    WHEN("deep ticking the nodes") {
+      net.deepTick(0);
+      check();
+    }
+
+    WHEN("deep ticking the compiled net") {
+      net.compile();
+      net.deepTick(0);
+      check();
+    }
+  }
+
+  GIVEN("A net with a cycle and an acyclic branch") {
+    sptn::PetriNet<> net;
+    net.addPlace("A", 1);
+    net.addPlace("B", 0);
+    net.addPlace("C", 1);
+    net.addPlace("D", 0);
+    net.transition(net.addTransition({"AB", {{"A", 1}}, {{"B", 1}}})).autoFire();
+    net.transition(net.addTransition({"BA", {{"B", 1}}, {{"A", 1}}})).autoFire();
+    net.transition(net.addTransition({"CD", {{"C", 1}}, {{"D", 1}}})).autoFire();
+
+    WHEN("a deepTick was aborted by the cycle") {
+      REQUIRE_THROWS_AS(net.deepTick("A"), std::runtime_error);
+
+      THEN("later deepTicks are not affected") {
+        REQUIRE_NOTHROW(net.deepTick("C"));
+        REQUIRE(net.findPlace("D")->getTokens() == 1);
+      }
+    }
+  }
+}
+
+TEST_CASE("sptn::PetriNet tickPrioritized()", "[SPTN][PetriNet]") {
+  GIVEN("Loading jobs competing for one crane") {
+    sptn::PetriNet<> net;
+    net.addPlace("crane", 1);
+    net.addPlace("jobs", 3);
+    net.addPlace("low", 0);
+    net.addPlace("high", 0);
+    net.addPlace("other", 0);
+    auto low = net.addTransition({"load_low", {{"crane", 1}, {"jobs", 1}}, {{"low", 1}}});
+    auto high = net.addTransition({"load_high", {{"crane", 1}, {"jobs", 1}}, {{"high", 1}}});
+    auto other = net.addTransition({"load_other", {{"jobs", 1}}, {{"other", 1}}});
+    for (auto t : {low, high, other}) {
+      net.transition(t).autoFire();
+    }
+
+    WHEN("ticking in insertion order") {
+      net.tick();
+
+      THEN("the first added transition wins") {
+        REQUIRE(net.marking() == std::vector<uint32_t>{0, 1, 1, 0, 1});
+      }
+    }
+
+    WHEN("ticking by priority") {
+      net.transition(high).setPriority(10);
+      net.transition(other).setPriority(-1);
+      net.tickPrioritized();
+
+      THEN("the transition with the highest priority wins") {
+        REQUIRE(net.transition(high).getPriority() == 10);
+        REQUIRE(net.marking() == std::vector<uint32_t>{0, 1, 0, 1, 1});
+      }
+    }
+
+    WHEN("ticking with equal priorities") {
+      net.tickPrioritized();
+
+      THEN("the lower handle wins") {
+        REQUIRE(net.marking() == std::vector<uint32_t>{0, 1, 1, 0, 1});
+      }
+    }
+
+    WHEN("the transition losing the crane counts its condition calls") {
+      std::size_t calls = 0;
+      net.transition(high).setPriority(10);
+      net.transition(low).autoFire([&calls](const auto &) {
+        ++calls;
+        return true;
+      });
+      net.tickPrioritized();
+
+      THEN("its condition is not evaluated after it was disabled") {
+        REQUIRE_FALSE(net.ready(low));
+        REQUIRE(calls == 0);
+        REQUIRE(net.marking() == std::vector<uint32_t>{0, 1, 0, 1, 1});
+      }
+    }
+
+    WHEN("a condition calls tickPrioritized() itself") {
+      bool nested = false;
+      net.transition(high).setPriority(10);
+      net.transition(high).autoFire([&](const auto &) {
+        if (!nested) {
+          nested = true;
+          net.tickPrioritized();
+        }
+        return true;
+      });
+      net.tickPrioritized();
+
+      THEN("the outer call keeps its own schedule") {
+        REQUIRE(net.marking() == std::vector<uint32_t>{0, 0, 0, 1, 2});
+      }
+    }
+  }
+}
+
+TEST_CASE("sptn::CompiledNet readyMask()", "[SPTN][PetriNet]") {
+  auto kernel = GENERATE(sptn::kernels::Kernel::k_scalar, sptn::kernels::Kernel::k_sse41,
+                         sptn::kernels::Kernel::k_avx2);
+  if (!sptn::kernels::supported(kernel)) {
+    WARN("Kernel " << static_cast<int>(kernel) << " is not supported by this CPU, skipped");
+    return;
+  }
+
+  GIVEN("A compiled net with rows of different length") {
+    sptn::PetriNet<> net;
+    constexpr uint32_t k_places = 97;
+    constexpr uint32_t k_transitions = 3000;
+    for (uint32_t p = 0; p < k_places; ++p) {
+      net.addPlace("P" + std::to_string(p), (p * 7) % 5);
+    }
+    for (uint32_t t = 0; t < k_transitions; ++t) {
+      sptn::PetriNet<>::TransitionSketch sketch{"T" + std::to_string(t), {}, {}};
+      // 0 to 6 ingoing arcs, so rows cross the chunks and words of the kernels
+      for (uint32_t k = 0; k < t % 7; ++k) {
+        sketch.ingoing.push_back({"P" + std::to_string((t * 13 + k * 31) % k_places), 1 + k % 3});
+      }
+      net.addTransition(std::move(sketch));
+    }
+    net.compile();
+    auto compiled = net.compiledNet();
+    auto marking = net.marking();
+
+    WHEN("evaluating the marking with the kernel") {
+      std::vector<uint64_t> mask;
+      compiled->readyMask(marking.data(), mask, kernel);
+
+      THEN("the mask matches ready()") {
+        REQUIRE(mask.size() == (k_transitions + 63) / 64);
+        for (std::size_t t = 0; t < k_transitions; ++t) {
+          bool bit = ((mask[t / 64] >> (t % 64)) & 1U) != 0;
+          REQUIRE(bit == compiled->ready(marking.data(), t));
+          REQUIRE(bit == net.ready(sptn::TransitionIndex(t)));
+        }
+      }
+    }
+  }
+}
+
+TEST_CASE("sptn::PetriNet enabledTransitions()", "[SPTN][PetriNet]") {
+  GIVEN("A net with more transitions than fit into one word") {
+    sptn::PetriNet<> net;
+    net.addPlace("even", 1);
+    net.addPlace("odd", 0);
+    for (int t = 0; t < 150; ++t) {
+      net.addTransition({"T" + std::to_string(t), {{t % 2 == 0 ? "even" : "odd", 1}}, {}});
+    }
+
+    WHEN("querying the enabled transitions") {
+      auto enabled = net.enabledTransitions();
+
+      THEN("the bitset contains exactly the enabled transitions") {
+        REQUIRE(enabled.size() == 150);
+        REQUIRE(enabled.count() == 75);
+        std::vector<sptn::TransitionIndex> expected;
+        for (std::size_t t = 0; t < 150; t += 2) {
+          expected.push_back(sptn::TransitionIndex(t));
+        }
+        REQUIRE(std::vector<sptn::TransitionIndex>(enabled.begin(), enabled.end()) == expected);
+        REQUIRE(std::vector<sptn::TransitionIndex>(enabled.begin(), enabled.end()) ==
+                net.enabled());
+      }
+
+      THEN("it can be intersected with other sets") {
+        sptn::TransitionSet wanted(150);
+        wanted.insert(sptn::TransitionIndex{1});
+        wanted.insert(sptn::TransitionIndex{64});
+        wanted.insert(sptn::TransitionIndex{149});
+        auto both = enabled & wanted;
+        REQUIRE(both.count() == 1);
+        REQUIRE(both.contains(sptn::TransitionIndex{64}));
+        REQUIRE((wanted - enabled).count() == 2);
+        REQUIRE((enabled | wanted).count() == 77);
+      }
+
+      THEN("it can be combined with sets of a larger net") {
+        sptn::TransitionSet larger(200);
+        larger.insert(sptn::TransitionIndex{0});
+        larger.insert(sptn::TransitionIndex{199});
+        auto both = enabled | larger;
+        REQUIRE(both.size() == 200);
+        REQUIRE(both.count() == 76);
+        REQUIRE(both.contains(sptn::TransitionIndex{199}));
+        auto rest = enabled - larger;
+        REQUIRE(rest.size() == 150);
+        REQUIRE(rest.count() == 74);
+        REQUIRE_FALSE(rest.contains(sptn::TransitionIndex{0}));
+      }
+
+      THEN("it matches the ready mask of the compiled net") {
+        net.compile();
+        std::vector<uint64_t> mask;
+        net.compiledNet()->readyMask(net.marking().data(), mask);
+        REQUIRE(sptn::TransitionSet(150, mask) == enabled);
+      }
+    }
+
+    WHEN("nothing is enabled") {
+      net.fire(sptn::TransitionIndex{0});
+
+      THEN("the bitset is empty") {
+        auto enabled = net.enabledTransitions();
+        REQUIRE(enabled.none());
+        REQUIRE(enabled.begin() == enabled.end());
+        REQUIRE(sptn::TransitionSet().begin() == sptn::TransitionSet().end());
+      }
+    }
+  }
+}
+
+TEST_CASE("sptn::PetriNet Locking::k_places and the atomic modes", "[SPTN][PetriNet]") {
+  auto locking =
+      GENERATE(sptn::Locking::k_places, sptn::Locking::k_atomic, sptn::Locking::k_optimistic);
+
+  GIVEN("Resource loops competing for freight, fired from multiple threads") {
+    constexpr int k_lines = 8;
+    constexpr int k_rounds = 2000;
+    constexpr uint32_t k_freight = 3;
+    sptn::PetriNet<> net(locking);
+    REQUIRE(net.locking() == locking);
+    net.addPlace("freight", k_freight);
+    std::vector<std::pair<sptn::TransitionIndex, sptn::TransitionIndex>> lines;
+    for (int i = 0; i < k_lines; ++i) {
+      auto id = std::to_string(i);
+      net.addPlace("free_" + id, 1);
+      net.addPlace("busy_" + id, 0);
+      // free_i is reserved before freight, so failing on freight gives free_i back
+      auto enter = net.addTransition(
+          {"enter_" + id, {{"free_" + id, 1}, {"freight", 1}}, {{"busy_" + id, 1}}});
+      auto leave = net.addTransition(
+          {"leave_" + id, {{"busy_" + id, 1}}, {{"free_" + id, 1}, {"freight", 1}}});
+      lines.emplace_back(enter, leave);
+    }
+    std::vector<std::string> ticked;
+    for (auto [enter, leave] : lines) {
+      net.transition(enter).autoFire([&](const auto &t) {
+        ticked.push_back(t.getID());
+        return false;
+      });
+    }
+    net.tickDirty();  // empty the dirty queue
+    ticked.clear();
+
+    std::atomic<int> changes = 0;
+    net.place(sptn::PlaceIndex{0}).onChange([&](const auto &, uint32_t) { ++changes; });
+
+    WHEN("firing all lines concurrently") {
+      std::vector<std::thread> threads;
+      std::atomic<int> fired = 0;
+      for (auto [enter, leave] : lines) {
+        threads.emplace_back([&, enter = enter, leave = leave]() {
+          for (int round = 0; round < k_rounds; ++round) {
+            fired += net.fire(enter) ? 1 : 0;
+            fired += net.transition(leave).fire() ? 1 : 0;
+          }
+        });
+      }
+      for (auto &thread : threads) {
+        thread.join();
+      }
+
+      THEN("no token was lost and the tracked state matches the marking") {
+        REQUIRE(fired > 0);
+        REQUIRE(changes == fired);
+        auto marking = net.marking();
+        uint32_t busy = 0;
+        std::vector<sptn::TransitionIndex> expected;
+        for (int i = 0; i < k_lines; ++i) {
+          auto free = marking[1 + 2 * i];
+          busy += marking[2 + 2 * i];
+          REQUIRE(free + marking[2 + 2 * i] == 1);
+          REQUIRE(net.tokens(sptn::PlaceIndex(1 + 2 * i)) == free);
+          if (free == 1 && marking[0] >= 1) {
+            expected.push_back(lines[i].first);
+          }
+          if (free == 0) {
+            expected.push_back(lines[i].second);
+          }
+          REQUIRE(net.ready(lines[i].first) == (free == 1 && marking[0] >= 1));
+        }
+        REQUIRE(marking[0] + busy == k_freight);
+        std::sort(begin(expected), end(expected));
+        REQUIRE(net.enabled() == expected);
+        REQUIRE(net.enabledTransitions().count() == expected.size());
+      }
+
+      THEN("the transitions of all changed places are queued as dirty") {
+        net.tickDirty();
+        REQUIRE(ticked.size() == k_lines);
+        ticked.clear();
+        net.tickDirty();
+        REQUIRE(ticked.empty());
+      }
+    }
+  }
+
+  GIVEN("Tokens which are not integral") {
+    if (locking == sptn::Locking::k_places) {
+      return;  // locking places does not need atomic tokens
+    }
+    THEN("the mode is rejected") {
+      REQUIRE_THROWS_AS((sptn::PetriNet<std::string, double>(locking)), std::invalid_argument);
+    }
+  }
+}
+
+TEST_CASE("sptn::PetriNet parallelTick()", "[SPTN][PetriNet]") {
+  auto locking = GENERATE(sptn::Locking::k_net, sptn::Locking::k_places, sptn::Locking::k_atomic,
+                          sptn::Locking::k_optimistic);
+
+  GIVEN("Lines sharing a few resources, built twice") {
+    constexpr int k_lines = 200;
+    auto build = [&](sptn::PetriNet<> &net) {
+      for (int r = 0; r < 4; ++r) {
+        net.addPlace("resource_" + std::to_string(r), 20);
+      }
+      net.addPlace("done", 0);
+      for (int i = 0; i < k_lines; ++i) {
+        auto id = std::to_string(i);
+        net.addPlace("in_" + id, 1);
+        net.addPlace("mid_" + id, 0);
+        auto resource = "resource_" + std::to_string(i % 4);
+        net.addTransition({"start_" + id, {{"in_" + id, 1}, {resource, 1}}, {{"mid_" + id, 1}}});
+        net.addTransition({"end_" + id, {{"mid_" + id, 1}}, {{"done", 1}, {resource, 1}}});
+      }
+      net.compile();
+    };
+    sptn::PetriNet<> net(locking);
+    sptn::PetriNet<> reference;
+    build(net);
+    build(reference);
+    auto compiled = net.compiledNet();
+
+    THEN("the colors partition the transitions without conflicts") {
+      std::vector<int> color_of(compiled->transitionCount(), -1);
+      for (std::size_t color = 0; color < compiled->colorCount(); ++color) {
+        auto [begin, end] = compiled->colorClass(color);
+        REQUIRE(begin != end);
+        for (const auto *t = begin; t != end; ++t) {
+          REQUIRE(color_of[*t] == -1);
+          color_of[*t] = static_cast<int>(color);
+        }
+      }
+      for (auto color : color_of) {
+        REQUIRE(color != -1);
+      }
+
+      // No place is consumed by one transition and touched by another of the same color
+      const auto &pre = compiled->pre();
+      const auto &post = compiled->post();
+      for (std::size_t t = 0; t < compiled->transitionCount(); ++t) {
+        for (auto k = pre.offsets[t]; k < pre.offsets[t + 1]; ++k) {
+          auto [begin, end] = compiled->consumers(pre.places[k]);
+          for (const auto *u = begin; u != end; ++u) {
+            REQUIRE((*u == t || color_of[*u] != color_of[t]));
+          }
+          for (std::size_t u = 0; u < compiled->transitionCount(); ++u) {
+            for (auto j = post.offsets[u]; j < post.offsets[u + 1]; ++j) {
+              if (post.places[j] == pre.places[k] && u != t) {
+                REQUIRE(color_of[u] != color_of[t]);
+              }
+            }
+          }
+        }
+      }
+    }
+
+    WHEN("ticking in parallel") {
+      std::vector<std::size_t> order;
+      for (std::size_t color = 0; color < compiled->colorCount(); ++color) {
+        auto [begin, end] = compiled->colorClass(color);
+        order.insert(order.end(), begin, end);
+      }
+      sptn::ThreadPool pool(4);
+      std::atomic<int> ticked = 0;
+      for (std::size_t t = 0; t < compiled->transitionCount(); ++t) {
+        net.transition(sptn::TransitionIndex(t)).autoFire([&](const auto &) {
+          ++ticked;
+          return true;
+        });
+      }
+
+      for (int round = 0; round < 3; ++round) {
+        net.parallelTick(pool);
+        for (auto t : order) {
+          reference.fire(sptn::TransitionIndex(t));
+        }
+      }
+
+      THEN("the result equals ticking sequentially color by color") {
+        REQUIRE(ticked == 3 * 2 * k_lines);
+        REQUIRE(net.marking() == reference.marking());
+        REQUIRE(net.enabled() == reference.enabled());
+        REQUIRE(net.findPlace("done")->getTokens() > 0);
+      }
+    }
+  }
+
+  GIVEN("A net which is not compiled") {
+    sptn::PetriNet<> net(locking);
+    net.addPlace("a", 1);
+    net.addPlace("b", 0);
+    net.addTransition({"t", {{"a", 1}}, {{"b", 1}}});
+    net.findTransition("t")->autoFire();
+    sptn::ThreadPool pool(2);
+
+    THEN("parallelTick() ticks sequentially") {
+      net.parallelTick(pool);
+      REQUIRE(net.marking() == std::vector<uint32_t>{0, 1});
+    }
+  }
+}
+
+TEST_CASE("sptn::PetriNet parallelDeepTick()", "[SPTN][PetriNet]") {
+  auto locking = GENERATE(sptn::Locking::k_net, sptn::Locking::k_places, sptn::Locking::k_atomic,
+                          sptn::Locking::k_optimistic);
+
+  GIVEN("A release transition forking into independent lines, built twice") {
+    constexpr int k_lines = 500;
+    auto build = [&](sptn::PetriNet<> &net) {
+      net.addPlace("trigger", 1);
+      sptn::PetriNet<>::TransitionSketch release{"release", {{"trigger", 1}}, {}};
+      for (int i = 0; i < k_lines; ++i) {
+        auto id = std::to_string(i);
+        net.addPlace("a_" + id, 0);
+        net.addPlace("b_" + id, 0);
+        net.addPlace("c_" + id, 0);
+        net.addTransition({"t_" + id, {{"a_" + id, 1}}, {{"b_" + id, 1}}});
+        net.addTransition({"u_" + id, {{"b_" + id, 1}}, {{"c_" + id, 2}}});
+        release.outgoing.push_back({"a_" + id, 1});
+      }
+      auto index = net.addTransition(release);
+      for (int i = 0; i < k_lines; ++i) {
+        auto id = std::to_string(i);
+        net.findTransition("t_" + id)->autoFire();
+        net.findTransition("u_" + id)->autoFire();
+      }
+      return index;
+    };
+    sptn::PetriNet<> net(locking);
+    sptn::PetriNet<> reference;
+    auto release = build(net);
+    build(reference);
+    sptn::ThreadPool pool(4);
+
+    WHEN("firing the release transition of the compiled net") {
+      net.compile();
+      REQUIRE(net.parallelDeepFire(release, pool));
+      reference.transition(release).deepFire();
+
+      THEN("all lines ran to their end, as with deepFire()") {
+        REQUIRE(net.marking() == reference.marking());
+        REQUIRE(net.findPlace("c_0")->getTokens() == 2);
+        REQUIRE(net.findPlace("c_" + std::to_string(k_lines - 1))->getTokens() == 2);
+        REQUIRE_FALSE(net.parallelDeepFire(release, pool));
+      }
+    }
+
+    WHEN("ticking the release transition of the compiled net") {
+      net.compile();
+      net.transition(release).autoFire();
+      reference.transition(release).autoFire();
+      net.parallelDeepTick(release, pool);
+      reference.transition(release).deepTick();
+
+      THEN("the result equals deepTick()") {
+        REQUIRE(net.marking() == reference.marking());
+      }
+    }
+
+    WHEN("the net is not compiled") {
+      THEN("the propagation runs sequentially") {
+        REQUIRE(net.parallelDeepFire(release, pool));
+        reference.transition(release).deepFire();
+        REQUIRE(net.marking() == reference.marking());
+      }
+    }
+  }
+
+  GIVEN("A compiled net with a cycle") {
+    sptn::PetriNet<> net(locking);
+    net.addPlace("a", 1);
+    net.addPlace("b", 0);
+    auto forth = net.addTransition({"forth", {{"a", 1}}, {{"b", 1}}});
+    net.addTransition({"back", {{"b", 1}}, {{"a", 1}}});
+    net.compile();
+    sptn::ThreadPool pool(2);
+
+    THEN("the propagation is rejected before firing") {
+      REQUIRE_THROWS_AS(net.parallelDeepFire(forth, pool), std::runtime_error);
+      REQUIRE(net.marking() == std::vector<uint32_t>{1, 0});
+    }
+  }
+}
+
+namespace {
+// Token counter with a user-provided copy constructor and no noexcept move constructor
+struct CopyCounter {
+  uint32_t value = 0;
+
+  CopyCounter() = default;
+  CopyCounter(uint32_t value) : value(value) {}  // NOLINT: implicit like an integer
+  CopyCounter(const CopyCounter &other) : value(other.value) {}
+  CopyCounter &operator=(const CopyCounter &other) = default;
+
+  CopyCounter operator+(const CopyCounter &other) const { return {this->value + other.value}; }
+  CopyCounter operator-(const CopyCounter &other) const { return {this->value - other.value}; }
+  bool operator<(const CopyCounter &other) const { return this->value < other.value; }
+};
+}  // namespace
+
+TEST_CASE("sptn::PetriNet custom token counter", "[SPTN][PetriNet]") {
+  GIVEN("A net counting with a type which is not nothrow movable") {
+    sptn::PetriNet<std::string, CopyCounter> net;
+    net.addPlace("a", 2);
+    net.addPlace("b", 0);
+    net.addPlace("c", 0);
+    net.addPlace("d", 0);
+    net.addPlace("e", 0);
+    auto t = net.addTransition({"t", {{"a", 1}}, {{"b", 1}, {"c", 1}, {"d", 1}, {"e", 1}}});
+
+    WHEN("firing a transition with spilled arcs") {
+      REQUIRE(net.fire(t));
+
+      THEN("the tokens moved") {
+        REQUIRE(net.tokens(sptn::PlaceIndex{0}).value == 1);
+        REQUIRE(net.tokens(sptn::PlaceIndex{4}).value == 1);
+      }
+    }
+  }
+}
@@ -11,6 +11,8 @@
 
 #include <catch2/catch.hpp>
 
+#include "SimplePTN/transition.hpp"
+
 enum class ID { k_one, k_two, k_three };
 
 struct Counter {
@@ -29,12 +31,22 @@ template <typename IDT = std::string, typename TokenCounterT = uint32_t> class P
 public:
   using PlaceT = Place<IDT, TokenCounterT>;
 
+  using NetStateT = NetState<IDT, TokenCounterT>;
+
+  // all proxy places share one marking
+  static std::shared_ptr<NetStateT> state() {
+    static auto state = std::make_shared<NetStateT>();
+    return state;
+  }
+
   static void fMapTokens(PlaceT &place, std::function<TokenCounterT(TokenCounterT)> f) {
-    place.tokens_ = f(place.tokens_);
+    place.tokensAcquired() = f(place.tokensAcquired());
   }
 
   static std::shared_ptr<PlaceT> makePlace(const IDT &id, TokenCounterT initial) {
-    return std::shared_ptr<PlaceT>(new PlaceT(id, initial));
+    state()->marking.push_back(initial);
+    auto index = PlaceIndex(state()->marking.size() - 1);
+    return std::shared_ptr<PlaceT>(new PlaceT(id, index, state().get()));
   }
 };
 
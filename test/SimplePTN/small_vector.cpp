@@ -0,0 +1,126 @@
+// Copyright Open Logistics Foundation
+// 
+// Licensed under the Open Logistics Foundation License 1.3.
+// For details on the licensing terms, see the LICENSE file.
+// SPDX-License-Identifier: OLFL-1.3
+// 
+
+#define CATCH_CONFIG_NO_POSIX_SIGNALS
+
+#include "SimplePTN/small_vector.hpp"
+
+#include <catch2/catch.hpp>
+#include <memory_resource>
+#include <string>
+
+namespace {
+
+// Has a copy constructor but no (noexcept) move constructor
+struct Copyable {
+  int value;
+
+  explicit Copyable(int value) : value(value) {}
+  Copyable(const Copyable &other) : value(other.value) {}
+  Copyable &operator=(const Copyable &other) = default;
+};
+
+}  // namespace
+
+TEST_CASE("sptn::SmallVector", "[SPTN][SmallVector]") {
+  GIVEN("A SmallVector with an inline capacity of 2") {
+    std::pmr::monotonic_buffer_resource resource;
+    sptn::SmallVector<std::string, 2> vec(&resource);
+
+    WHEN("storing up to 2 elements") {
+      vec.push_back("a");
+      vec.emplace_back(2, 'b');
+
+      THEN("the elements are stored inline") {
+        REQUIRE_FALSE(vec.spilled());
+        REQUIRE(vec.size() == 2);
+        REQUIRE(vec[0] == "a");
+        REQUIRE(vec[1] == "bb");
+      }
+    }
+
+    WHEN("storing more than 2 elements") {
+      for (int i = 0; i < 5; ++i) {
+        vec.push_back(std::to_string(i));
+      }
+
+      THEN("the elements spill to the resource") {
+        REQUIRE(vec.spilled());
+        REQUIRE(vec.size() == 5);
+        REQUIRE(vec.capacity() >= 5);
+        for (int i = 0; i < 5; ++i) {
+          REQUIRE(vec[i] == std::to_string(i));
+        }
+      }
+
+      THEN("pop_back() keeps the capacity") {
+        auto capacity = vec.capacity();
+        vec.pop_back();
+        REQUIRE(vec.size() == 4);
+        REQUIRE(vec.capacity() == capacity);
+        REQUIRE(vec[3] == "3");
+      }
+
+      THEN("moving steals the spilled elements") {
+        const auto *data = vec.data();
+        auto moved = std::move(vec);
+        REQUIRE(moved.data() == data);
+        REQUIRE(moved.size() == 5);
+        REQUIRE(vec.empty());
+        REQUIRE_FALSE(vec.spilled());
+      }
+    }
+
+    WHEN("moving an inline vector") {
+      vec.push_back("a");
+      sptn::SmallVector<std::string, 2> moved;
+      moved.push_back("x");
+      moved = std::move(vec);
+
+      THEN("the elements are moved") {
+        REQUIRE(moved.size() == 1);
+        REQUIRE(moved[0] == "a");
+        REQUIRE(vec.empty());
+      }
+    }
+  }
+
+  GIVEN("A full SmallVector") {
+    sptn::SmallVector<std::string, 2> vec;
+    vec.push_back(std::string(32, 'a'));
+    vec.push_back("b");
+
+    WHEN("appending one of its own elements") {
+      vec.push_back(vec[0]);
+
+      THEN("the element is copied before the storage is reallocated") {
+        REQUIRE(vec.spilled());
+        REQUIRE(vec.size() == 3);
+        REQUIRE(vec[2] == std::string(32, 'a'));
+        REQUIRE(vec[0] == std::string(32, 'a'));
+      }
+    }
+  }
+
+  GIVEN("A SmallVector of elements whose move constructor may throw") {
+    sptn::SmallVector<Copyable, 1> vec;
+
+    WHEN("spilling") {
+      for (int i = 0; i < 5; ++i) {
+        vec.emplace_back(i);
+      }
+
+      THEN("the elements are copied to the spill") {
+        REQUIRE(vec.spilled());
+        REQUIRE(vec.size() == 5);
+        for (int i = 0; i < 5; ++i) {
+          REQUIRE(vec[i].value == i);
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,147 @@
+// Copyright Open Logistics Foundation
+// 
+// Licensed under the Open Logistics Foundation License 1.3.
+// For details on the licensing terms, see the LICENSE file.
+// SPDX-License-Identifier: OLFL-1.3
+// 
+
+#define CATCH_CONFIG_NO_POSIX_SIGNALS
+
+#include "SimplePTN/thread_pool.hpp"
+
+#include <atomic>
+#include <catch2/catch.hpp>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+TEST_CASE("sptn::ThreadPool", "[SPTN][ThreadPool]") {
+  GIVEN("A ThreadPool with 4 threads") {
+    sptn::ThreadPool pool(4);
+    REQUIRE(pool.size() == 4);
+
+    WHEN("running loops") {
+      constexpr std::size_t k_count = 10000;
+      std::vector<std::atomic<int>> calls(k_count);
+      for (int loop = 0; loop < 3; ++loop) {
+        pool.parallelFor(k_count, [&](std::size_t i) { ++calls[i]; });
+      }
+
+      THEN("every index is visited once per loop") {
+        for (const auto &count : calls) {
+          REQUIRE(count == 3);
+        }
+      }
+    }
+
+    WHEN("a call throws") {
+      std::atomic<int> calls = 0;
+      auto loop = [&]() {
+        pool.parallelFor(1000, [&](std::size_t i) {
+          ++calls;
+          if (i == 500) {
+            throw std::runtime_error("failed");
+          }
+        });
+      };
+
+      THEN("the exception is rethrown and the pool stays usable") {
+        REQUIRE_THROWS_AS(loop(), std::runtime_error);
+        REQUIRE(calls <= 1000);
+        std::atomic<int> after = 0;
+        pool.parallelFor(100, [&](std::size_t) { ++after; });
+        REQUIRE(after == 100);
+      }
+    }
+  }
+
+  GIVEN("A ThreadPool with 4 threads running tasks") {
+    sptn::ThreadPool pool(4);
+
+    WHEN("a single task spawns a binary tree of tasks") {
+      constexpr std::size_t k_tasks = 20000;
+      std::vector<std::atomic<int>> runs(k_tasks);
+      pool.runTasks({0}, [&](std::size_t task, auto &spawn) {
+        ++runs[task];
+        for (auto child : {2 * task + 1, 2 * task + 2}) {
+          if (child < k_tasks) {
+            spawn(child);
+          }
+        }
+      });
+
+      THEN("every task runs once") {
+        for (const auto &count : runs) {
+          REQUIRE(count == 1);
+        }
+      }
+    }
+
+    WHEN("a task spawns tasks after the other threads went idle") {
+      std::atomic<int> started = 0;
+      std::atomic<bool> met = false;
+      pool.runTasks({0}, [&](std::size_t task, auto &spawn) {
+        if (task == 0) {
+          std::this_thread::sleep_for(std::chrono::milliseconds(20));
+          for (std::size_t child = 1; child < 4; ++child) {
+            spawn(child);
+          }
+          return;
+        }
+        // Every spawned task waits for the others, so they have to run on different threads
+        ++started;
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (started.load() < 3 && std::chrono::steady_clock::now() < deadline) {
+          std::this_thread::yield();
+        }
+        if (started.load() == 3) {
+          met = true;
+        }
+      });
+
+      THEN("the idle threads are woken to run them") { REQUIRE(met); }
+    }
+
+    WHEN("a task throws") {
+      auto run = [&]() {
+        pool.runTasks({0, 1, 2, 3}, [&](std::size_t task, auto &spawn) {
+          if (task == 100) {
+            throw std::runtime_error("failed");
+          }
+          spawn(task + 4);
+        });
+      };
+
+      THEN("the exception is rethrown and the pool stays usable") {
+        REQUIRE_THROWS_AS(run(), std::runtime_error);
+        std::atomic<int> runs = 0;
+        pool.runTasks({0, 1}, [&](std::size_t, auto &) { ++runs; });
+        REQUIRE(runs == 2);
+      }
+    }
+  }
+
+  GIVEN("A ThreadPool of size 0") {
+    sptn::ThreadPool pool(0);
+
+    THEN("loops run on the calling thread") {
+      REQUIRE(pool.size() == 1);
+      std::vector<std::size_t> visited;
+      pool.parallelFor(5, [&](std::size_t i) { visited.push_back(i); });
+      REQUIRE(visited == std::vector<std::size_t>{0, 1, 2, 3, 4});
+    }
+
+    THEN("tasks run on the calling thread, newest first") {
+      std::vector<std::size_t> visited;
+      pool.runTasks({0}, [&](std::size_t task, auto &spawn) {
+        visited.push_back(task);
+        if (task == 0) {
+          spawn(1);
+          spawn(2);
+        }
+      });
+      REQUIRE(visited == std::vector<std::size_t>{0, 2, 1});
+    }
+  }
+}
@@ -25,19 +25,40 @@ public:
   using TransitionT = Transition<IDT, TokenCounterT>;
   using WeightPairT = typename TransitionT::WeightPairT;
 
+  using NetStateT = NetState<IDT, TokenCounterT>;
+
+  // all proxy places share one marking
+  static std::shared_ptr<NetStateT> state() {
+    static auto state = std::make_shared<NetStateT>();
+    return state;
+  }
+
   static void fMapTokens(PlaceT &place, std::function<TokenCounterT(TokenCounterT)> f) {
-    place.tokens_ = f(place.tokens_);
+    place.tokensAcquired() = f(place.tokensAcquired());
+  }
+
+  using SharedWeightPairT = std::pair<std::shared_ptr<PlaceT>, TokenCounterT>;
+
+  static std::vector<WeightPairT> toWeightPairs(const std::vector<SharedWeightPairT> &pairs) {
+    std::vector<WeightPairT> raw;
+    for (const auto &[place, weight] : pairs) {
+      raw.push_back({place.get(), weight});
+    }
+    return raw;
   }
 
   static std::shared_ptr<TransitionT> makeTransition(const IDT &id,
-                                                     std::vector<WeightPairT> &&ingoing,
-                                                     std::vector<WeightPairT> &&outgoing) {
-    return std::shared_ptr<TransitionT>(new TransitionT(id, std::move(ingoing), std::move(outgoing),
-                                                        std::make_shared<std::shared_mutex>()));
+                                                     std::vector<SharedWeightPairT> &&ingoing,
+                                                     std::vector<SharedWeightPairT> &&outgoing) {
+    return std::shared_ptr<TransitionT>(new TransitionT(id, TransitionIndex{},
+                                                        toWeightPairs(ingoing),
+                                                        toWeightPairs(outgoing), state().get()));
   }
 
   static std::shared_ptr<PlaceT> makePlace(const IDT &id, TokenCounterT initial) {
-    return std::shared_ptr<PlaceT>(new PlaceT(id, initial));
+    state()->marking.push_back(initial);
+    auto index = PlaceIndex(state()->marking.size() - 1);
+    return std::shared_ptr<PlaceT>(new PlaceT(id, index, state().get()));
   }
 };
 
@@ -183,3 +204,143 @@ TEST_CASE("sptn::Transition triggers onChange of places", "[SPTN][Transition]")
     }
   }
 }
+
+TEST_CASE("sptn::Transition with a large fan-in", "[SPTN][Transition]") {
+  GIVEN("A Transition with more ingoing Places than stored inline") {
+    std::vector<sptn::PetriNet<>::SharedWeightPairT> ingoing;
+    for (int i = 0; i < 8; ++i) {
+      ingoing.push_back({sptn::PetriNet<>::makePlace("In" + std::to_string(i), 1), 1});
+    }
+    auto out = sptn::PetriNet<>::makePlace("Out", 0);
+    auto transition = sptn::PetriNet<>::makeTransition("T", std::move(ingoing), {{out, 8}});
+
+    WHEN("firing the transition") {
+      REQUIRE(transition->fire());
+
+      THEN("all ingoing places are consumed") {
+        REQUIRE(out->getTokens() == 8);
+        REQUIRE_FALSE(transition->ready());
+      }
+    }
+  }
+}
+
+TEST_CASE("sptn::Transition notifies many places", "[SPTN][Transition]") {
+  GIVEN("A Transition with more observed places than notified without allocation") {
+    auto in = sptn::PetriNet<>::makePlace("In", 1);
+    std::vector<sptn::PetriNet<>::SharedWeightPairT> outgoing;
+    std::vector<std::shared_ptr<sptn::Place<>>> places;
+    for (int i = 0; i < 12; ++i) {
+      places.push_back(sptn::PetriNet<>::makePlace("Out" + std::to_string(i), 0));
+      outgoing.push_back({places.back(), 1});
+    }
+    auto unobserved = sptn::PetriNet<>::makePlace("Unobserved", 0);
+    outgoing.push_back({unobserved, 1});
+    auto transition = sptn::PetriNet<>::makeTransition("T", {{in, 1}}, std::move(outgoing));
+
+    std::map<std::string, uint32_t> on_change_calls;
+    auto registerChange = [&](const sptn::Place<> &p, uint32_t) {
+      on_change_calls[p.getID()] = p.getTokens();
+    };
+    for (auto &place : places) {
+      place->onChange(registerChange);
+    }
+
+    WHEN("firing the transition") {
+      REQUIRE(transition->fire());
+
+      THEN("exactly the observed places get notified") {
+        REQUIRE(on_change_calls.size() == 12);
+        for (int i = 0; i < 12; ++i) {
+          REQUIRE(on_change_calls["Out" + std::to_string(i)] == 1);
+        }
+        REQUIRE(unobserved->getTokens() == 1);
+      }
+    }
+  }
+}
+
+TEST_CASE("sptn::Transition fireN() and fireMax()", "[SPTN][Transition]") {
+  GIVEN("A Transition consuming a burst of freight") {
+    auto freight = sptn::PetriNet<>::makePlace("freight", 7);
+    auto crane = sptn::PetriNet<>::makePlace("crane", 5);
+    auto ship = sptn::PetriNet<>::makePlace("ship", 0);
+    auto transition = sptn::PetriNet<>::makeTransition("load", {{freight, 2}, {crane, 1}},
+                                                       {{ship, 1}, {crane, 1}});
+
+    std::map<std::string, std::vector<uint32_t>> on_change_calls;
+    auto registerChange = [&](const sptn::Place<> &p, uint32_t prev) {
+      on_change_calls[p.getID()].push_back(prev);
+    };
+    for (auto *place : {freight.get(), crane.get(), ship.get()}) {
+      place->onChange(registerChange);
+    }
+
+    WHEN("firing more often than enabled") {
+      THEN("nothing happens") {
+        REQUIRE_FALSE(transition->fireN(4));
+        REQUIRE(freight->getTokens() == 7);
+        REQUIRE(on_change_calls.empty());
+      }
+    }
+
+    WHEN("firing 0 times") {
+      THEN("nothing happens") {
+        REQUIRE_FALSE(transition->fireN(0));
+        REQUIRE(freight->getTokens() == 7);
+        REQUIRE(on_change_calls.empty());
+      }
+    }
+
+    WHEN("weight * n overflows") {
+      auto split = sptn::PetriNet<>::makeTransition("split", {{freight, 3}}, {{ship, 1}});
+
+      THEN("the transition is not ready") {
+        // 3 * 0x55555556 wraps around to 2
+        REQUIRE_FALSE(split->fireN(0x55555556U));
+        REQUIRE(freight->getTokens() == 7);
+        REQUIRE(on_change_calls.empty());
+      }
+    }
+
+    WHEN("firing n times") {
+      REQUIRE(transition->fireN(2));
+
+      THEN("the tokens change once per place") {
+        REQUIRE(freight->getTokens() == 3);
+        REQUIRE(crane->getTokens() == 5);
+        REQUIRE(ship->getTokens() == 2);
+        REQUIRE(on_change_calls == std::map<std::string, std::vector<uint32_t>>{
+                                       {"freight", {7}}, {"crane", {5}}, {"ship", {0}}});
+      }
+    }
+
+    WHEN("firing as often as enabled") {
+      REQUIRE(transition->fireMax() == 3);
+
+      THEN("the transition is not ready anymore") {
+        REQUIRE(freight->getTokens() == 1);
+        REQUIRE(ship->getTokens() == 3);
+        REQUIRE_FALSE(transition->ready());
+        REQUIRE(transition->fireMax() == 0);
+      }
+    }
+  }
+}
+
+TEST_CASE("sptn::Transition fireMax() with fractional tokens", "[SPTN][Transition]") {
+  GIVEN("A Transition consuming fractional tokens") {
+    auto in = sptn::PetriNet<std::string, double>::makePlace("in", 2.5);
+    auto out = sptn::PetriNet<std::string, double>::makePlace("out", 0);
+    auto transition =
+        sptn::PetriNet<std::string, double>::makeTransition("t", {{in, 1.0}}, {{out, 1.0}});
+
+    WHEN("firing as often as enabled") {
+      THEN("the transition fires a whole number of times") {
+        REQUIRE(transition->fireMax() == 2.0);
+        REQUIRE(in->getTokens() == 0.5);
+        REQUIRE(out->getTokens() == 2.0);
+      }
+    }
+  }
+}